@@ -0,0 +1,560 @@
+/*
+ *      A benchmark comparing a trie with the containers of the standard library.
+ *
+ * Copyright (c) 2008, Naoaki Okazaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Northwestern University, University of Tokyo,
+ *       nor the names of its contributors may be used to endorse or promote
+ *       products derived from this software without specific prior written
+ *       permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* $Id$ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <dastrie.h>
+#include <optparse.h>
+
+#include <time.h>
+
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && 1900 <= _MSC_VER)
+#define DASTRIE_BENCH_CXX11
+#include <chrono>
+#include <unordered_map>
+#endif
+
+class option : public optparse
+{
+public:
+    std::string queries;
+    int rounds;
+    bool help;
+
+public:
+    option() : rounds(1), help(false)
+    {
+    }
+
+    BEGIN_OPTION_MAP_INLINE()
+        ON_OPTION_WITH_ARG(SHORTOPT('q') || LONGOPT("queries"))
+            queries = arg;
+
+        ON_OPTION_WITH_ARG(SHORTOPT('R') || LONGOPT("rounds"))
+            rounds = std::atoi(arg);
+            if (rounds <= 0) {
+                std::stringstream ss;
+                ss << "the number of rounds must be positive: " << arg;
+                throw invalid_value(ss.str());
+            }
+
+        ON_OPTION(SHORTOPT('h') || LONGOPT("help"))
+            help = true;
+
+    END_OPTION_MAP()
+};
+
+static void usage(std::ostream& os, const char *argv0)
+{
+    os << "USAGE: " << argv0 << " [OPTIONS] INPUT" << std::endl;
+    os << "This utility runs identical build and look-up workloads against std::map," << std::endl;
+    os << "std::unordered_map, a sorted std::vector, and dastrie::trie with 4-byte," << std::endl;
+    os << "5-byte, and 8-byte elements, and reports the results in a table." << std::endl;
+    os << std::endl;
+    os << "  INPUT   an input file in which each line represents a record; a record (line)" << std::endl;
+    os << "          consists of a key string and its value (optional) separated by a TAB" << std::endl;
+    os << "          character; the records must be sorted by dictionary order of keys." << std::endl;
+    os << std::endl;
+    os << "OPTIONS:" << std::endl;
+    os << "  -q, --queries=FILE read queries from FILE (one per line); by default, the keys" << std::endl;
+    os << "                     in INPUT are used as queries" << std::endl;
+    os << "  -R, --rounds=N     repeat the queries N times [DEFAULT: 1]" << std::endl;
+    os << "  -h, --help         show this help message and exit" << std::endl;
+    os << std::endl;
+    os << "COLUMNS:" << std::endl;
+    os << "  Build      seconds until the structure is ready for look-ups (for a trie," << std::endl;
+    os << "             building, writing, and reading the database in memory)" << std::endl;
+    os << "  Lookup     nanoseconds per exact-match look-up" << std::endl;
+    os << "  Prefix     nanoseconds per query for finding all keys that are prefixes of" << std::endl;
+    os << "             the query (by one look-up per prefix length for the containers)" << std::endl;
+    os << "  Bytes/key  heap memory allocated by a container, or the size of the trie" << std::endl;
+    os << "             database, divided by the number of keys" << std::endl;
+}
+
+/**
+ * Memory allocated through counting_allocator.
+ */
+struct allocation
+{
+    static size_t& bytes()
+    {
+        static size_t n = 0;
+        return n;
+    }
+};
+
+/**
+ * An allocator that counts the bytes allocated by a container.
+ */
+template <class T>
+class counting_allocator
+{
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+
+    template <class U>
+    struct rebind
+    {
+        typedef counting_allocator<U> other;
+    };
+
+    counting_allocator()
+    {
+    }
+
+    template <class U>
+    counting_allocator(const counting_allocator<U>&)
+    {
+    }
+
+    pointer address(reference x) const
+    {
+        return &x;
+    }
+
+    const_pointer address(const_reference x) const
+    {
+        return &x;
+    }
+
+    pointer allocate(size_type n, const void* = 0)
+    {
+        allocation::bytes() += n * sizeof(T);
+        return static_cast<pointer>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(pointer p, size_type n)
+    {
+        allocation::bytes() -= n * sizeof(T);
+        ::operator delete(p);
+    }
+
+    size_type max_size() const
+    {
+        return (size_type)-1 / sizeof(T);
+    }
+
+    void construct(pointer p, const T& value)
+    {
+        new(p) T(value);
+    }
+
+    void destroy(pointer p)
+    {
+        p->~T();
+    }
+
+    template <class U>
+    bool operator==(const counting_allocator<U>&) const
+    {
+        return true;
+    }
+
+    template <class U>
+    bool operator!=(const counting_allocator<U>&) const
+    {
+        return false;
+    }
+};
+
+typedef std::basic_string<char, std::char_traits<char>, counting_allocator<char> > string_type;
+typedef std::vector<string_type> strings_type;
+
+static double now()
+{
+#if defined(DASTRIE_BENCH_CXX11)
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+    return clock() / (double)CLOCKS_PER_SEC;
+#endif
+}
+
+struct result
+{
+    std::string name;
+    bool ok;
+    double build;
+    double lookup;
+    double prefix;
+    double bytes;
+    size_t hits;
+    size_t prefix_hits;
+
+    result(const std::string& n) :
+        name(n), ok(true), build(0), lookup(0), prefix(0), bytes(0), hits(0), prefix_hits(0)
+    {
+    }
+};
+
+/**
+ * Runs the workload against a container with find().
+ */
+template <class container_type>
+class container_bench
+{
+protected:
+    container_type m_cont;
+
+public:
+    void build(const strings_type& keys)
+    {
+        for (size_t i = 0;i < keys.size();++i) {
+            m_cont.insert(typename container_type::value_type(keys[i], (int)i));
+        }
+    }
+
+    bool find(const string_type& key, int& value) const
+    {
+        typename container_type::const_iterator it = m_cont.find(key);
+        if (it != m_cont.end()) {
+            value = it->second;
+            return true;
+        }
+        return false;
+    }
+};
+
+/**
+ * Runs the workload against a sorted vector with binary search.
+ */
+class vector_bench
+{
+protected:
+    typedef std::pair<string_type, int> pair_type;
+    typedef std::vector<pair_type, counting_allocator<pair_type> > container_type;
+    container_type m_cont;
+
+    static bool less(const pair_type& x, const pair_type& y)
+    {
+        return x.first < y.first;
+    }
+
+public:
+    void build(const strings_type& keys)
+    {
+        m_cont.reserve(keys.size());
+        for (size_t i = 0;i < keys.size();++i) {
+            m_cont.push_back(pair_type(keys[i], (int)i));
+        }
+        std::sort(m_cont.begin(), m_cont.end(), less);
+    }
+
+    bool find(const string_type& key, int& value) const
+    {
+        container_type::const_iterator it = std::lower_bound(
+            m_cont.begin(), m_cont.end(), pair_type(key, 0), less);
+        if (it != m_cont.end() && it->first == key) {
+            value = it->second;
+            return true;
+        }
+        return false;
+    }
+};
+
+#if defined(DASTRIE_BENCH_CXX11)
+struct string_hash
+{
+    size_t operator()(const string_type& str) const
+    {
+        // FNV-1a.
+        uint64_t h = 14695981039346656037ULL;
+        for (size_t i = 0;i < str.length();++i) {
+            h = (h ^ (uint8_t)str[i]) * 1099511628211ULL;
+        }
+        return (size_t)h;
+    }
+};
+#endif
+
+template <class bench_type>
+static void run_container(
+    result& r,
+    const strings_type& keys,
+    const strings_type& queries,
+    int rounds
+    )
+{
+    size_t base = allocation::bytes();
+    bench_type* bench = new bench_type;
+
+    double start = now();
+    bench->build(keys);
+    r.build = now() - start;
+    r.bytes = (double)(allocation::bytes() - base) / keys.size();
+
+    // Exact-match look-ups.
+    int value;
+    start = now();
+    for (int k = 0;k < rounds;++k) {
+        for (size_t i = 0;i < queries.size();++i) {
+            if (bench->find(queries[i], value)) {
+                ++r.hits;
+            }
+        }
+    }
+    r.lookup = (now() - start) * 1e9 / ((double)queries.size() * rounds);
+
+    // Prefix look-ups by querying every prefix of a query.
+    string_type prefix;
+    start = now();
+    for (int k = 0;k < rounds;++k) {
+        for (size_t i = 0;i < queries.size();++i) {
+            const string_type& q = queries[i];
+            for (size_t n = 1;n <= q.length();++n) {
+                prefix.assign(q, 0, n);
+                if (bench->find(prefix, value)) {
+                    ++r.prefix_hits;
+                }
+            }
+        }
+    }
+    r.prefix = (now() - start) * 1e9 / ((double)queries.size() * rounds);
+
+    delete bench;
+}
+
+template <class traits_type>
+static void run_trie(
+    result& r,
+    const strings_type& keys,
+    const strings_type& queries,
+    int rounds
+    )
+{
+    typedef dastrie::builder<const char*, int, traits_type> builder_type;
+    typedef dastrie::trie<int, traits_type> trie_type;
+    typedef typename builder_type::record_type record_type;
+
+    std::vector<record_type> records(keys.size());
+    for (size_t i = 0;i < keys.size();++i) {
+        records[i].key = keys[i].c_str();
+        records[i].value = (int)i;
+    }
+
+    // Build, write, and read a trie.
+    trie_type trie;
+    double start = now();
+    try {
+        builder_type builder;
+        builder.build(&records[0], &records[0] + records.size());
+        std::stringstream ss;
+        builder.write(ss);
+        r.bytes = (double)trie.read(ss) / keys.size();
+    } catch (const typename builder_type::exception& e) {
+        std::cerr << "ERROR: " << r.name << ": " << e.what() << std::endl;
+        r.ok = false;
+        return;
+    }
+    r.build = now() - start;
+
+    // Exact-match look-ups.
+    int value;
+    start = now();
+    for (int k = 0;k < rounds;++k) {
+        for (size_t i = 0;i < queries.size();++i) {
+            if (trie.find(queries[i].c_str(), value)) {
+                ++r.hits;
+            }
+        }
+    }
+    r.lookup = (now() - start) * 1e9 / ((double)queries.size() * rounds);
+
+    // Prefix look-ups with a cursor.
+    start = now();
+    for (int k = 0;k < rounds;++k) {
+        for (size_t i = 0;i < queries.size();++i) {
+            typename trie_type::prefix_cursor pfx = trie.prefix(queries[i].c_str());
+            while (pfx.next()) {
+                ++r.prefix_hits;
+            }
+        }
+    }
+    r.prefix = (now() - start) * 1e9 / ((double)queries.size() * rounds);
+}
+
+static bool read_lines(const char *filename, strings_type& lines)
+{
+    std::ifstream ifs(filename);
+    if (ifs.fail()) {
+        return false;
+    }
+
+    // Read the keys (before a TAB, if any).
+    std::string line;
+    while (std::getline(ifs, line)) {
+        std::string::size_type tab = line.find('\t');
+        if (tab != std::string::npos) {
+            line.erase(tab);
+        }
+        lines.push_back(string_type(line.c_str(), line.length()));
+    }
+    return true;
+}
+
+static void output_results(std::ostream& os, const std::vector<result>& results)
+{
+    os << std::left << std::setw(20) << "Structure" << std::right <<
+        std::setw(12) << "Build [s]" <<
+        std::setw(12) << "Lookup [ns]" <<
+        std::setw(12) << "Prefix [ns]" <<
+        std::setw(12) << "Bytes/key" <<
+        std::setw(10) << "Hits" << std::endl;
+
+    for (size_t i = 0;i < results.size();++i) {
+        const result& r = results[i];
+        os << std::left << std::setw(20) << r.name << std::right;
+        if (!r.ok) {
+            os << std::setw(12) << "n/a" << std::endl;
+            continue;
+        }
+        os << std::fixed <<
+            std::setw(12) << std::setprecision(4) << r.build <<
+            std::setw(12) << std::setprecision(1) << r.lookup <<
+            std::setw(12) << std::setprecision(1) << r.prefix <<
+            std::setw(12) << std::setprecision(1) << r.bytes <<
+            std::setw(10) << r.hits << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    option opt;
+    int ret = 0;
+    int arg_used = 0;
+    std::ostream& es = std::cerr;
+    std::ostream& os = std::cout;
+
+    // Show the copyright information.
+    es << "DASTrie benchmark ";
+    es << DASTRIE_MAJOR_VERSION << "." << DASTRIE_MINOR_VERSION << " ";
+    es << DASTRIE_COPYRIGHT << std::endl;
+    es << std::endl;
+
+    // Parse the command-line options.
+    try {
+        arg_used = opt.parse(argv, argc);
+    } catch (const optparse::unrecognized_option& e) {
+        es << "ERROR: unrecognized option: " << e.what() << std::endl;
+        return 1;
+    } catch (const optparse::invalid_value& e) {
+        es << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+
+    // Show the help message and exit.
+    if (opt.help) {
+        usage(os, argv[0]);
+        return ret;
+    }
+
+    // Make sure that an input file is specified.
+    if (argc <= arg_used) {
+        es << "ERROR: No input file specified." << std::endl;
+        return 1;
+    }
+
+    // Read the keys and queries.
+    strings_type keys, queries;
+    if (!read_lines(argv[arg_used], keys) || keys.empty()) {
+        es << "ERROR: Failed to read the input data." << std::endl;
+        return 1;
+    }
+    if (opt.queries.empty()) {
+        queries = keys;
+    } else if (!read_lines(opt.queries.c_str(), queries) || queries.empty()) {
+        es << "ERROR: Failed to read the queries." << std::endl;
+        return 1;
+    }
+
+    os << "Number of keys: " << keys.size() << std::endl;
+    os << "Number of queries: " << queries.size() << " x " << opt.rounds << std::endl;
+    os << std::endl;
+
+    // Run the workloads.
+    std::vector<result> results;
+    typedef std::map<
+        string_type, int, std::less<string_type>,
+        counting_allocator<std::pair<const string_type, int> >
+        > map_type;
+    results.push_back(result("std::map"));
+    run_container<container_bench<map_type> >(results.back(), keys, queries, opt.rounds);
+
+#if defined(DASTRIE_BENCH_CXX11)
+    typedef std::unordered_map<
+        string_type, int, string_hash, std::equal_to<string_type>,
+        counting_allocator<std::pair<const string_type, int> >
+        > unordered_map_type;
+    results.push_back(result("std::unordered_map"));
+    run_container<container_bench<unordered_map_type> >(results.back(), keys, queries, opt.rounds);
+#endif
+
+    results.push_back(result("sorted std::vector"));
+    run_container<vector_bench>(results.back(), keys, queries, opt.rounds);
+
+    results.push_back(result("dastrie (4 bytes)"));
+    run_trie<dastrie::doublearray4_traits>(results.back(), keys, queries, opt.rounds);
+
+    results.push_back(result("dastrie (5 bytes)"));
+    run_trie<dastrie::doublearray5_traits>(results.back(), keys, queries, opt.rounds);
+
+    results.push_back(result("dastrie (8 bytes)"));
+    run_trie<dastrie::doublearray8_traits>(results.back(), keys, queries, opt.rounds);
+
+    output_results(os, results);
+
+    // The containers must agree with each other.
+    for (size_t i = 1;i < results.size();++i) {
+        if (results[i].ok && (results[i].hits != results[0].hits ||
+            results[i].prefix_hits != results[0].prefix_hits)) {
+            es << "ERROR: " << results[i].name << " disagrees with " <<
+                results[0].name << std::endl;
+            ret = 1;
+        }
+    }
+    return ret;
+}
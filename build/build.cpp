@@ -37,6 +37,7 @@
 #include <sstream>
 #include <dastrie.h>
 #include <optparse.h>
+#include <perfcounter.h>
 
 class option : public optparse
 {
@@ -50,11 +51,22 @@ public:
 
     int type;
     bool compact;
+    bool wide;
+    bool automatic;
+    bool bfs;
+    int jump;
+    bool pool;
+    bool binary;
+    bool embed;
+    bool counts;
+    bool ignore_case;
+    bool counters;
     std::string db;
+    std::string json;
     bool help;
 
 public:
-    option() : type(TYPE_EMPTY), compact(false), help(false)
+    option() : type(TYPE_EMPTY), compact(false), wide(false), automatic(false), bfs(false), jump(0), pool(false), binary(false), embed(false), counts(false), ignore_case(false), counters(false), help(false)
     {
     }
 
@@ -77,9 +89,55 @@ public:
         ON_OPTION(SHORTOPT('c') || LONGOPT("compact"))
             compact = true;
 
+        ON_OPTION(SHORTOPT('w') || LONGOPT("wide"))
+            wide = true;
+
+        ON_OPTION(SHORTOPT('a') || LONGOPT("auto"))
+            automatic = true;
+
         ON_OPTION_WITH_ARG(SHORTOPT('d') || LONGOPT("db"))
             db = arg;
 
+        ON_OPTION_WITH_ARG(SHORTOPT('o') || LONGOPT("order"))
+            if (strcmp(arg, "dfs") == 0) {
+                bfs = false;
+            } else if (strcmp(arg, "bfs") == 0) {
+                bfs = true;
+            } else {
+                std::stringstream ss;
+                ss << "unknown order specified: " << arg;
+                throw invalid_value(ss.str());
+            }
+
+        ON_OPTION_WITH_ARG(SHORTOPT('j') || LONGOPT("jump"))
+            jump = std::atoi(arg);
+            if (jump < 0 || 2 < jump) {
+                std::stringstream ss;
+                ss << "the depth of jump tables must be 0, 1, or 2: " << arg;
+                throw invalid_value(ss.str());
+            }
+
+        ON_OPTION(SHORTOPT('p') || LONGOPT("pool"))
+            pool = true;
+
+        ON_OPTION(SHORTOPT('b') || LONGOPT("binary"))
+            binary = true;
+
+        ON_OPTION(SHORTOPT('e') || LONGOPT("embed"))
+            embed = true;
+
+        ON_OPTION(SHORTOPT('k') || LONGOPT("counts"))
+            counts = true;
+
+        ON_OPTION(SHORTOPT('i') || LONGOPT("ignore-case"))
+            ignore_case = true;
+
+        ON_OPTION(SHORTOPT('C') || LONGOPT("counters"))
+            counters = true;
+
+        ON_OPTION_WITH_ARG(SHORTOPT('J') || LONGOPT("json"))
+            json = arg;
+
         ON_OPTION(SHORTOPT('h') || LONGOPT("help"))
             help = true;
 
@@ -104,8 +162,40 @@ static void usage(std::ostream& os, const char *argv0)
     os << "  -c, --compact      make a double array trie compact by storing a double-array" << std::endl;
     os << "                     element in 4 bytes; this compaction is available only when" << std::endl;
     os << "                     the number of records are small" << std::endl;
+    os << "  -w, --wide         store a double-array element in 8 bytes, and the first bytes" << std::endl;
+    os << "                     of the key postfix in each leaf element; look-ups read the" << std::endl;
+    os << "                     tail only for postfixes longer than two bytes" << std::endl;
+    os << "  -a, --auto         choose the compact format (-c) if the records are estimated" << std::endl;
+    os << "                     to fit into it, and rebuild with the normal format if not;" << std::endl;
+    os << "                     the format is recorded in the database" << std::endl;
     os << "  -d, --db           specify a database file to which the double array trie will" << std::endl;
     os << "                     be stored; by default, this utility write no database" << std::endl;
+    os << "  -o, --order=ORDER  specify the order of arranging nodes in the double array:" << std::endl;
+    os << "      dfs                depth-first order [DEFAULT]" << std::endl;
+    os << "      bfs                breadth-first order; the upper levels of the trie are" << std::endl;
+    os << "                         stored in a small contiguous region" << std::endl;
+    os << "  -j, --jump=DEPTH   store jump tables that resolve the first DEPTH (1 or 2)" << std::endl;
+    os << "                     bytes of keys without descending the trie; the tables" << std::endl;
+    os << "                     use 1 KB (DEPTH=1) or 257 KB (DEPTH=2)" << std::endl;
+    os << "  -p, --pool         store each distinct string value only once in a pool, and" << std::endl;
+    os << "                     refer to it from records (effective with -t string)" << std::endl;
+    os << "  -b, --binary       read keys as hexadecimal strings and store the decoded bytes" << std::endl;
+    os << "                     as binary keys, which may contain any byte including NUL;" << std::endl;
+    os << "                     the records must be sorted by the decoded bytes" << std::endl;
+    os << "  -e, --embed        store the value of a record in its leaf element instead of" << std::endl;
+    os << "                     the tail when the key ends at the leaf (effective with" << std::endl;
+    os << "                     -t empty and -t int)" << std::endl;
+    os << "  -k, --counts       store the number of keys under each node so that look-ups" << std::endl;
+    os << "                     count the keys starting with a prefix in a single descent" << std::endl;
+    os << "  -i, --ignore-case  store keys in lower case, and make look-ups ignore the case" << std::endl;
+    os << "                     of ASCII letters in queries; the records must be sorted by" << std::endl;
+    os << "                     the lower-cased keys" << std::endl;
+    os << "  -C, --counters     count instructions, branch misses, L1D, LLC, and dTLB misses" << std::endl;
+    os << "                     in each phase of the build with hardware performance" << std::endl;
+    os << "                     counters (Linux)" << std::endl;
+    os << "  -J, --json=FILE    write the statistics of the trie and the distributions of" << std::endl;
+    os << "                     node depths, fanouts, leaf depths, TAIL postfix lengths," << std::endl;
+    os << "                     and parent-child distances (log2 buckets) to FILE in JSON" << std::endl;
     os << "  -h, --help         show this help message and exit" << std::endl;
 }
 
@@ -220,6 +310,53 @@ static void set_records(
     }
 }
 
+static int hex_digit(char c)
+{
+    if ('0' <= c && c <= '9') {
+        return c - '0';
+    } else if ('a' <= c && c <= 'f') {
+        return c - 'a' + 10;
+    } else if ('A' <= c && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static bool decode_hex(const char *str, std::string& bytes)
+{
+    bytes.clear();
+    for (;*str;str += 2) {
+        int hi = hex_digit(str[0]);
+        int lo = str[1] ? hex_digit(str[1]) : -1;
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        bytes += (char)(hi * 16 + lo);
+    }
+    return true;
+}
+
+static void lower_case(uint8_t *fold)
+{
+    for (int c = 0;c < dastrie::NUMCHARS;++c) {
+        fold[c] = ('A' <= c && c <= 'Z') ? (uint8_t)(c - 'A' + 'a') : (uint8_t)c;
+    }
+}
+
+static void fold_key(char *key, const uint8_t *fold)
+{
+    for (;*key;++key) {
+        *key = (char)fold[(uint8_t)*key];
+    }
+}
+
+static void fold_key(std::string& key, const uint8_t *fold)
+{
+    for (size_t i = 0;i < key.length();++i) {
+        key[i] = (char)fold[(uint8_t)key[i]];
+    }
+}
+
 class progress
 {
 protected:
@@ -257,44 +394,178 @@ public:
     }
 };
 
-template <class value_type, class traits_type>
-int build(char *text, size_t size, const option& opt)
+class phase_counters
 {
-    typedef dastrie::builder<char*, value_type, traits_type> builder_type;
-    typedef typename builder_type::record_type record_type;
+protected:
+    perf_counters m_pc;
+    std::vector<std::vector<uint64_t> > m_values;
 
-    std::ostream& os = std::cout;
-    std::ostream& es = std::cerr;
+public:
+    phase_counters() : m_values(4)
+    {
+    }
 
-    // Count the number of records in the input text.
-    size_t n = count_records(text);
-    if (n == 0) {
-        es << "ERROR: No records in the input data." << std::endl;
-        return 1;
+    virtual ~phase_counters()
+    {
     }
 
-    // Allocate an array of records.
-    record_type* records = new record_type[n];
-    std::memset(records, 0, sizeof(record_type) * n);
+    static void callback(void *instance, int phase, bool begin)
+    {
+        phase_counters* pcs = reinterpret_cast<phase_counters*>(instance);
+        if (begin) {
+            pcs->m_pc.start();
+        } else {
+            pcs->m_pc.stop();
+            std::vector<uint64_t>& values = pcs->m_values[phase];
+            values.resize(perf_counters::NUM_EVENTS);
+            for (int i = 0;i < perf_counters::NUM_EVENTS;++i) {
+                values[i] = pcs->m_pc.value(i);
+            }
+        }
+    }
 
-    // Set records from the input text.
-    set_records(records, n, text); 
+    void output(std::ostream& os, size_t n) const
+    {
+        static const char *phases[] = {"table", "arrange", "stat", "write"};
+        os << "[Hardware counters]" << std::endl;
+        if (!m_pc.available()) {
+            os << "Unavailable" << std::endl;
+            return;
+        }
+        for (size_t p = 0;p < m_values.size();++p) {
+            if (m_values[p].empty()) {
+                continue;
+            }
+            os << "Phase " << phases[p] << ":";
+            for (int i = 0;i < perf_counters::NUM_EVENTS;++i) {
+                if (m_pc.available(i)) {
+                    os << " " << perf_counters::name(i) << " " << m_values[p][i] <<
+                        " (" << (double)m_values[p][i] / n << " per record);";
+                }
+            }
+            os << std::endl;
+        }
+    }
+};
 
-    os << "Size of input text: " << size << std::endl;
-    os << "Number of records: " << n << std::endl;
+template <class histogram_type>
+static void output_json_histogram(std::ostream& os, const char *name, const histogram_type& hist)
+{
+    os << "    \"" << name << "\": [";
+    for (size_t i = 0;i < hist.size();++i) {
+        os << (i == 0 ? "" : ", ") << hist[i];
+    }
+    os << "]";
+}
+
+template <class stat_type>
+static void output_json(std::ostream& os, const stat_type& stat, size_t element_size)
+{
+    os << "{" << std::endl;
+    os << "  \"element_size\": " << element_size << "," << std::endl;
+    os << "  \"da_size\": " << stat.da_size << "," << std::endl;
+    os << "  \"da_num_total\": " << stat.da_num_total << "," << std::endl;
+    os << "  \"da_num_used\": " << stat.da_num_used << "," << std::endl;
+    os << "  \"da_num_nodes\": " << stat.da_num_nodes << "," << std::endl;
+    os << "  \"da_num_leaves\": " << stat.da_num_leaves << "," << std::endl;
+    os << "  \"da_num_inline\": " << stat.da_num_inline << "," << std::endl;
+    os << "  \"da_usage\": " << stat.da_usage << "," << std::endl;
+    os << "  \"da_top_depth\": " << stat.da_top_depth << "," << std::endl;
+    os << "  \"da_top_num\": " << stat.da_top_num << "," << std::endl;
+    os << "  \"da_top_size\": " << stat.da_top_size << "," << std::endl;
+    os << "  \"tail_size\": " << stat.tail_size << "," << std::endl;
+    os << "  \"pool_size\": " << stat.pool_size << "," << std::endl;
+    os << "  \"pool_num_strings\": " << stat.pool_num_strings << "," << std::endl;
+    os << "  \"bt_avg_base_trials\": " << stat.bt_avg_base_trials << "," << std::endl;
+    os << "  \"histograms\": {" << std::endl;
+    output_json_histogram(os, "node_depth", stat.hist_node_depth);
+    os << "," << std::endl;
+    output_json_histogram(os, "fanout", stat.hist_fanout);
+    os << "," << std::endl;
+    output_json_histogram(os, "leaf_depth", stat.hist_leaf_depth);
+    os << "," << std::endl;
+    output_json_histogram(os, "tail_length", stat.hist_tail_length);
+    os << "," << std::endl;
+    output_json_histogram(os, "child_distance_log2", stat.hist_child_distance);
     os << std::endl;
+    os << "  }" << std::endl;
+    os << "}" << std::endl;
+}
+
+enum {
+    /// Returned by build() when the records do not fit into the format.
+    RETRY = -1,
+};
+
+template <class builder_type>
+int build_records(
+    typename builder_type::record_type* records,
+    size_t n,
+    const option& opt,
+    bool fallback
+    )
+{
+    std::ostream& os = std::cout;
+    std::ostream& es = std::cerr;
 
-    // Build a double-array trie.
     builder_type builder;
+    phase_counters pcs;
+    if (opt.counters) {
+        builder.set_phase_callback(&pcs, pcs.callback);
+    }
+
+    // Store the keys in lower case.
+    if (opt.ignore_case) {
+        uint8_t fold[dastrie::NUMCHARS];
+        lower_case(fold);
+        for (size_t i = 0;i < n;++i) {
+            fold_key(records[i].key, fold);
+        }
+    }
+
+    // Estimate the size of the trie to choose the format.
+    if (opt.automatic) {
+        size_t num_elements = 0, tail_bytes = 0;
+        bool fit = builder.estimate(records, records + n, num_elements, tail_bytes);
+        os << "Estimated number of elements: " << num_elements << std::endl;
+        os << "Estimated size of tail in bytes: " << tail_bytes << std::endl;
+        os << "Size of an element in bytes: " << sizeof(typename builder_type::element_type) << std::endl;
+        os << std::endl;
+        if (!fit && fallback) {
+            os << "The records do not fit into the format; retrying with a larger format" << std::endl;
+            os << std::endl;
+            return RETRY;
+        }
+    }
+
+    // Build a double-array trie.
     try {
         progress prog(os);
         builder.set_callback(&prog, prog.callback);
+        if (opt.bfs) {
+            builder.set_order(builder_type::ORDER_BFS);
+        }
+        builder.set_jump(opt.jump);
+        builder.set_pool(opt.pool);
+        builder.set_binary(opt.binary);
+        builder.set_inline_values(opt.embed);
+        builder.set_counts(opt.counts);
+        if (opt.ignore_case) {
+            uint8_t fold[dastrie::NUMCHARS];
+            lower_case(fold);
+            builder.set_fold(fold);
+        }
         os << "Building a double array trie..." << std::endl;
         builder.build(records, records + n);
         os << std::endl << std::endl;
     } catch (const typename builder_type::exception& e) {
         // Abort if something went wrong...
         os << std::endl << std::endl;
+        if (fallback) {
+            os << "Retrying with a larger format: " << e.what() << std::endl;
+            os << std::endl;
+            return RETRY;
+        }
         es << "ERROR: " << e.what() << std::endl;
         return 1;
     }
@@ -305,14 +576,34 @@ int build(char *text, size_t size, const option& opt)
     os << "Size in bytes: " << stat.da_size << std::endl;
     os << "Number of nodes: " << stat.da_num_nodes << std::endl;
     os << "Number of leaves: " << stat.da_num_leaves << std::endl;
+    if (opt.embed) {
+        os << "Number of leaves storing values: " << stat.da_num_inline << std::endl;
+    }
     os << "Number of elements: " << stat.da_num_total << std::endl;
     os << "Number of elements used: " << stat.da_num_used << std::endl;
     os << "Storage utilization: " << stat.da_usage << std::endl;
     os << "Average number of trials for finding bases: " << stat.bt_avg_base_trials << std::endl;
+    os << "Number of elements in top " << stat.da_top_depth << " levels: " << stat.da_top_num << std::endl;
+    os << "Size in bytes spanned by top " << stat.da_top_depth << " levels: " << stat.da_top_size << std::endl;
     os << "[Tail array]" << std::endl;
     os << "Size in bytes: " << stat.tail_size << std::endl;
+    if (opt.pool) {
+        os << "[Value pool]" << std::endl;
+        os << "Size in bytes: " << stat.pool_size << std::endl;
+        os << "Number of strings: " << stat.pool_num_strings << std::endl;
+    }
     os << std::endl;
 
+    // Write the statistics in JSON.
+    if (!opt.json.empty()) {
+        std::ofstream ofs(opt.json.c_str());
+        if (ofs.fail()) {
+            es << "ERROR: Failed to open the JSON file: " << opt.json << std::endl;
+            return 1;
+        }
+        output_json(ofs, stat, sizeof(typename builder_type::element_type));
+    }
+
     // Write the database.
     if (!opt.db.empty()) {
         std::ofstream ofs;
@@ -320,9 +611,83 @@ int build(char *text, size_t size, const option& opt)
         builder.write(ofs);
     }
 
+    if (opt.counters) {
+        pcs.output(os, n);
+        os << std::endl;
+    }
+
     return 0;    
 }
 
+template <class value_type, class traits_type>
+int build(char *text, size_t size, const option& opt, bool fallback = false)
+{
+    typedef dastrie::builder<char*, value_type, traits_type> builder_type;
+    typedef typename builder_type::record_type record_type;
+
+    std::ostream& os = std::cout;
+    std::ostream& es = std::cerr;
+
+    // Count the number of records in the input text.
+    size_t n = count_records(text);
+    if (n == 0) {
+        es << "ERROR: No records in the input data." << std::endl;
+        return 1;
+    }
+
+    // Allocate an array of records.
+    record_type* records = new record_type[n];
+    std::memset(records, 0, sizeof(record_type) * n);
+
+    // Set records from the input text.
+    set_records(records, n, text); 
+
+    os << "Size of input text: " << size << std::endl;
+    os << "Number of records: " << n << std::endl;
+    os << std::endl;
+
+    int ret = 0;
+    if (opt.binary) {
+        // Decode the hexadecimal keys into binary keys.
+        typedef dastrie::builder<std::string, value_type, traits_type> binary_builder_type;
+        typedef typename binary_builder_type::record_type binary_record_type;
+        std::vector<binary_record_type> binary_records(n);
+        for (size_t i = 0;i < n;++i) {
+            if (!decode_hex(records[i].key, binary_records[i].key)) {
+                es << "ERROR: Invalid hexadecimal key: " << records[i].key << std::endl;
+                delete[] records;
+                return 1;
+            }
+            binary_records[i].value = records[i].value;
+        }
+        ret = build_records<binary_builder_type>(&binary_records[0], n, opt, fallback);
+    } else {
+        ret = build_records<builder_type>(records, n, opt, fallback);
+    }
+
+    delete[] records;
+    return ret;
+}
+
+template <class value_type>
+int build_auto(const char *filename, char *text, size_t size, const option& opt)
+{
+    int ret = build<value_type, dastrie::doublearray4_traits>(text, size, opt, true);
+    if (ret != RETRY) {
+        return ret;
+    }
+
+    // The records were modified by the first attempt; read them again.
+    std::streamoff textsize;
+    delete[] text;
+    text = read_text(filename, textsize);
+    if (text == NULL) {
+        std::cerr << "ERROR: Failed to read the input data." << std::endl;
+        return 1;
+    }
+    return build<value_type, dastrie::doublearray5_traits>(text, (size_t)textsize, opt);
+}
+
 int main(int argc, char *argv[])
 {
     option opt;
@@ -370,11 +735,18 @@ int main(int argc, char *argv[])
 
     switch (opt.type) {
     case option::TYPE_EMPTY:
-        if (opt.compact) {
+        if (opt.automatic) {
+            return build_auto<dastrie::empty_type>(argv[arg_used], text, (size_t)textsize, opt);
+        } else if (opt.compact) {
             return build<
                 dastrie::empty_type,
                 dastrie::doublearray4_traits
             >(text, (size_t)textsize, opt);
+        } else if (opt.wide) {
+            return build<
+                dastrie::empty_type,
+                dastrie::doublearray8_traits
+            >(text, (size_t)textsize, opt);
         } else {
             return build<
                 dastrie::empty_type,
@@ -382,11 +754,18 @@ int main(int argc, char *argv[])
             >(text, (size_t)textsize, opt);
         }
     case option::TYPE_INT:
-        if (opt.compact) {
+        if (opt.automatic) {
+            return build_auto<int>(argv[arg_used], text, (size_t)textsize, opt);
+        } else if (opt.compact) {
             return build<
                 int,
                 dastrie::doublearray4_traits
             >(text, (size_t)textsize, opt);
+        } else if (opt.wide) {
+            return build<
+                int,
+                dastrie::doublearray8_traits
+            >(text, (size_t)textsize, opt);
         } else {
             return build<
                 int,
@@ -394,11 +773,18 @@ int main(int argc, char *argv[])
             >(text, (size_t)textsize, opt);
         }
     case option::TYPE_DOUBLE:
-        if (opt.compact) {
+        if (opt.automatic) {
+            return build_auto<double>(argv[arg_used], text, (size_t)textsize, opt);
+        } else if (opt.compact) {
             return build<
                 double,
                 dastrie::doublearray4_traits
             >(text, (size_t)textsize, opt);
+        } else if (opt.wide) {
+            return build<
+                double,
+                dastrie::doublearray8_traits
+            >(text, (size_t)textsize, opt);
         } else {
             return build<
                 double,
@@ -406,11 +792,18 @@ int main(int argc, char *argv[])
             >(text, (size_t)textsize, opt);
         }
     case option::TYPE_STRING:
-        if (opt.compact) {
+        if (opt.automatic) {
+            return build_auto<char*>(argv[arg_used], text, (size_t)textsize, opt);
+        } else if (opt.compact) {
             return build<
                 char*,
                 dastrie::doublearray4_traits
             >(text, (size_t)textsize, opt);
+        } else if (opt.wide) {
+            return build<
+                char*,
+                dastrie::doublearray8_traits
+            >(text, (size_t)textsize, opt);
         } else {
             return build<
                 char*,
@@ -0,0 +1,79 @@
+/*
+ *      A regression test for the code generated by dastrie-codegen.
+ *
+ * Copyright (c) 2008, Naoaki Okazaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Northwestern University, University of Tokyo,
+ *       nor the names of its contributors may be used to endorse or promote
+ *       products derived from this software without specific prior written
+ *       permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* $Id$ */
+
+
+#include <iostream>
+#include "check.h"
+
+struct query_type
+{
+    const char *key;
+    bool found;
+    int value;
+};
+
+int main()
+{
+    // Keys in check.txt, and strings that reach unused elements or stop
+    // in the middle of keys.
+    static const query_type queries[] = {
+        {"accept", true, 1},
+        {"accept-charset", true, 2},
+        {"age", true, 3},
+        {"host", true, 4},
+        {"hosts", true, 5},
+        {"x", true, 6},
+        {"", false, 0},
+        {"a", false, 0},
+        {"acce", false, 0},
+        {"accept-", false, 0},
+        {"ag", false, 0},
+        {"hos", false, 0},
+        {"hostsx", false, 0},
+        {"xx", false, 0},
+        {"y", false, 0},
+    };
+
+    int errors = 0;
+    for (size_t i = 0;i < sizeof(queries) / sizeof(queries[0]);++i) {
+        const query_type& q = queries[i];
+        int value = 0;
+        bool found = check_dictionary::find(q.key, value);
+        if (found != q.found || (found && value != q.value)) {
+            std::cerr << "ERROR: find(\"" << q.key << "\") returned " << found
+                << " with the value " << value << std::endl;
+            ++errors;
+        }
+    }
+    return (errors == 0) ? 0 : 1;
+}
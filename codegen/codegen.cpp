@@ -0,0 +1,631 @@
+/*
+ *      A program for generating specialized lookup code from records.
+ *
+ * Copyright (c) 2008,2009, Naoaki Okazaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Northwestern University, University of Tokyo,
+ *       nor the names of its contributors may be used to endorse or promote
+ *       products derived from this software without specific prior written
+ *       permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* $Id$ */
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <dastrie.h>
+#include <optparse.h>
+
+class option : public optparse
+{
+public:
+    enum {
+        TYPE_EMPTY,
+        TYPE_INT,
+        TYPE_DOUBLE,
+        TYPE_STRING,
+    };
+
+    int type;
+    bool compact;
+    bool bench;
+    std::string name;
+    std::string output;
+    bool help;
+
+public:
+    option() :
+        type(TYPE_EMPTY), compact(false), bench(false),
+        name("dictionary"), help(false)
+    {
+    }
+
+    BEGIN_OPTION_MAP_INLINE()
+        ON_OPTION_WITH_ARG(SHORTOPT('t') || LONGOPT("type"))
+            if (strcmp(arg, "empty") == 0) {
+                type = TYPE_EMPTY;
+            } else if (strcmp(arg, "int") == 0) {
+                type = TYPE_INT;
+            } else if (strcmp(arg, "double") == 0) {
+                type = TYPE_DOUBLE;
+            } else if (strcmp(arg, "string") == 0) {
+                type = TYPE_STRING;
+            } else {
+                std::stringstream ss;
+                ss << "unknown record type specified: " << arg;
+                throw invalid_value(ss.str());
+            }
+
+        ON_OPTION(SHORTOPT('c') || LONGOPT("compact"))
+            compact = true;
+
+        ON_OPTION_WITH_ARG(SHORTOPT('n') || LONGOPT("name"))
+            name = arg;
+
+        ON_OPTION_WITH_ARG(SHORTOPT('o') || LONGOPT("output"))
+            output = arg;
+
+        ON_OPTION(SHORTOPT('b') || LONGOPT("bench"))
+            bench = true;
+
+        ON_OPTION(SHORTOPT('h') || LONGOPT("help"))
+            help = true;
+
+    END_OPTION_MAP()
+};
+
+static void usage(std::ostream& os, const char *argv0)
+{
+    os << "USAGE: " << argv0 << " [OPTIONS] INPUT" << std::endl;
+    os << "This utility generates a C++ source code of a lookup function specialized for" << std::endl;
+    os << "the records in an input file (INPUT)." << std::endl;
+    os << std::endl;
+    os << "  INPUT   an input file in which each line represents a record; a record (line)" << std::endl;
+    os << "          consists of a key string and its value (optional) separated by a TAB" << std::endl;
+    os << "          character; the records must be sorted by dictionary order of keys." << std::endl;
+    os << std::endl;
+    os << "OPTIONS:" << std::endl;
+    os << "  -t, --type=TYPE    specify a type of record values:" << std::endl;
+    os << "      empty              no values [DEFAULT]; the trie will store keys only" << std::endl;
+    os << "      int                integer values" << std::endl;
+    os << "      double             floating-point values" << std::endl;
+    os << "      string             string values" << std::endl;
+    os << "  -n, --name=NAME    specify the name of the generated class [DEFAULT=dictionary]" << std::endl;
+    os << "  -o, --output=FILE  specify a file to which the source code will be written;" << std::endl;
+    os << "                     by default, this utility writes the code to STDOUT" << std::endl;
+    os << "  -b, --bench        append a main() function that compares the generated code" << std::endl;
+    os << "                     with dastrie::trie; the program receives a database file," << std::endl;
+    os << "                     a key file, and the number of rounds (optional)" << std::endl;
+    os << "  -c, --compact      let the benchmark read a database built with -c option" << std::endl;
+    os << "  -h, --help         show this help message and exit" << std::endl;
+}
+
+
+static char* read_text(const char *filename, std::streamoff& size)
+{
+    // Open the input file.
+    std::ifstream ifs(filename);
+    if (ifs.fail()) {
+        return NULL;
+    }
+
+    // Get the size of the input file.
+    ifs.seekg(0, std::ios::end);
+    size = (std::streamoff)ifs.tellg();
+    ifs.seekg(0, std::ios::beg);
+
+    // Read the entire data of the input file.
+    char *block = new char[size+1];
+    std::memset(block, 0, sizeof(char) * (size+1));
+    ifs.read(block, size);
+    return block;
+}
+
+static size_t count_records(const char *block)
+{
+    size_t n = 0;
+    const char *p = block;
+
+    while (*p) {
+        if (*p == '\n') {
+            ++n;
+        }
+        ++p;
+    }
+
+    if (*block) {
+        if (p[-1] != '\n') {
+            ++n;
+        }
+    }
+
+    return n;
+}
+
+inline static void init_value(dastrie::empty_type& /*value*/)
+{
+}
+
+inline static void init_value(int& value)
+{
+    value = 0;
+}
+
+inline static void init_value(double& value)
+{
+    value = 0;
+}
+
+inline static void init_value(char*& value)
+{
+    static char empty[] = "";
+    value = empty;
+}
+
+inline static void set_value(char * /*p*/, dastrie::empty_type& /*value*/)
+{
+}
+
+inline static void set_value(char *p, int& value)
+{
+    *p = 0;
+    value = std::atoi(p+1);
+}
+
+inline static void set_value(char *p, double& value)
+{
+    *p = 0;
+    value = std::atof(p+1);
+}
+
+inline static void set_value(char *p, char*& value)
+{
+    *p = 0;
+    value = p+1;
+}
+
+template <class record_type>
+static void set_records(
+    record_type* records,
+    size_t n,
+    char *block
+    )
+{
+    size_t i = 0;
+    char *p = block;
+
+    while (i < n) {
+        if (records[i].key == NULL) {
+            records[i].key = p;
+            init_value(records[i].value);
+        }
+        if (*p == 0) {
+            break;
+        } else if (*p == '\t') {
+            set_value(p, records[i].value);
+        } else if (*p == '\n') {
+            *p = 0;
+            ++i;
+        }
+        ++p;
+    }
+}
+
+static std::string quote(const char *str)
+{
+    std::stringstream ss;
+    ss << '"';
+    for (const char *p = str;*p;++p) {
+        uint8_t c = (uint8_t)*p;
+        if (c == '"' || c == '\\') {
+            ss << '\\' << (char)c;
+        } else if (0x20 <= c && c < 0x7F && c != '?') {
+            ss << (char)c;
+        } else {
+            // Octal escapes never swallow the following characters.
+            ss << '\\' << std::oct << std::setw(3) << std::setfill('0')
+               << (int)c << std::dec;
+        }
+    }
+    ss << '"';
+    return ss.str();
+}
+
+static std::string character(uint8_t c)
+{
+    std::stringstream ss;
+    ss << "0x" << std::hex << std::setw(2) << std::setfill('0') << (int)c;
+    if (0x20 < c && c < 0x7F && c != '/' && c != '*' && c != '\\') {
+        ss << ": /* '" << (char)c << "' */";
+    } else {
+        ss << ":";
+    }
+    return ss.str();
+}
+
+inline static const char *value_type_name(const dastrie::empty_type& /*value*/)
+{
+    return "struct { }";
+}
+
+inline static const char *value_type_name(const int& /*value*/)
+{
+    return "int";
+}
+
+inline static const char *value_type_name(const double& /*value*/)
+{
+    return "double";
+}
+
+inline static const char *value_type_name(char* const& /*value*/)
+{
+    return "const char*";
+}
+
+inline static const char *trie_value_type_name(const dastrie::empty_type& /*value*/)
+{
+    return "dastrie::empty_type";
+}
+
+inline static const char *trie_value_type_name(const int& /*value*/)
+{
+    return "int";
+}
+
+inline static const char *trie_value_type_name(const double& /*value*/)
+{
+    return "double";
+}
+
+inline static const char *trie_value_type_name(char* const& /*value*/)
+{
+    return "char*";
+}
+
+inline static std::ostream& output_assignment(
+    std::ostream& os, const std::string& /*indent*/, const dastrie::empty_type& /*value*/)
+{
+    return os;
+}
+
+inline static std::ostream& output_assignment(
+    std::ostream& os, const std::string& indent, const int& value)
+{
+    os << indent << "value = " << value << ";" << std::endl;
+    return os;
+}
+
+inline static std::ostream& output_assignment(
+    std::ostream& os, const std::string& indent, const double& value)
+{
+    os << indent << "value = " << std::setprecision(17) << value << ";" << std::endl;
+    return os;
+}
+
+inline static std::ostream& output_assignment(
+    std::ostream& os, const std::string& indent, char* const& value)
+{
+    os << indent << "value = " << quote(value) << ";" << std::endl;
+    return os;
+}
+
+/**
+ * An emitter of nested switch statements that follow the double array.
+ */
+template <class value_type, class traits_type>
+class generator
+{
+protected:
+    typedef dastrie::builder<char*, value_type, traits_type> builder_type;
+    typedef typename builder_type::doublearray_type doublearray_type;
+    typedef typename builder_type::size_type size_type;
+    typedef typename traits_type::base_type base_type;
+
+    std::ostream& m_os;
+    const doublearray_type& m_da;
+    const uint8_t* m_table;
+    dastrie::itail m_tail;
+
+public:
+    generator(std::ostream& os, const builder_type& builder)
+        : m_os(os), m_da(builder.doublearray()), m_table(builder.table())
+    {
+        m_tail.assign(builder.tail().block(), builder.tail().bytes());
+    }
+
+    void generate(size_type depth, size_type cur, const std::string& indent)
+    {
+        const std::string inner = indent + "    ";
+        base_type base = traits_type::get_base(m_da[cur]);
+
+        // A trie with a single record consists of a leaf node.
+        if (base < 0) {
+            output_leaf(depth, base, false, indent);
+            return;
+        }
+
+        m_os << indent << "switch (p[" << depth << "]) {" << std::endl;
+        for (int c = 0;c < dastrie::NUMCHARS;++c) {
+            // Enumerate the child nodes in the order of byte values.
+            uint8_t check = m_table[c];
+            size_type next = (size_type)base + (size_type)check + 1;
+            if (m_da.size() <= next || traits_type::get_check(m_da[next]) != check) {
+                continue;
+            }
+            base_type child = traits_type::get_base(m_da[next]);
+            if (child == 0) {
+                // An unused element, whose CHECK may match the code 0.
+                continue;
+            }
+
+            m_os << indent << "case " << character((uint8_t)c) << std::endl;
+            if (0 < child) {
+                generate(depth+1, next, inner);
+            } else {
+                // The key string has already terminated at the null arc.
+                output_leaf(depth+1, child, (c == 0), inner);
+            }
+        }
+        m_os << indent << "}" << std::endl;
+        m_os << indent << "return false;" << std::endl;
+    }
+
+protected:
+    void output_leaf(size_type depth, base_type base, bool terminated, const std::string& indent)
+    {
+        std::string postfix;
+        value_type value;
+
+        // Read the key postfix and value stored in the TAIL.
+        m_tail.seekg((size_type)-base);
+        m_tail >> postfix;
+        m_tail >> value;
+
+        if (terminated) {
+            output_assignment(m_os, indent, value);
+            m_os << indent << "return true;" << std::endl;
+            return;
+        }
+
+        if (postfix.empty()) {
+            m_os << indent << "if (p[" << depth << "] == 0) {" << std::endl;
+        } else {
+            m_os << indent << "if (std::strcmp(key + " << depth << ", "
+                 << quote(postfix.c_str()) << ") == 0) {" << std::endl;
+        }
+        output_assignment(m_os, indent + "    ", value);
+        m_os << indent << "    return true;" << std::endl;
+        m_os << indent << "}" << std::endl;
+        m_os << indent << "return false;" << std::endl;
+    }
+};
+
+template <class value_type, class traits_type>
+static void output_bench(std::ostream& os, const option& opt)
+{
+    value_type value;
+    os << std::endl;
+    os << "#include <ctime>" << std::endl;
+    os << "#include <cstdlib>" << std::endl;
+    os << "#include <fstream>" << std::endl;
+    os << "#include <iostream>" << std::endl;
+    os << "#include <string>" << std::endl;
+    os << "#include <vector>" << std::endl;
+    os << "#include <dastrie.h>" << std::endl;
+    os << std::endl;
+    os << "int main(int argc, char *argv[])" << std::endl;
+    os << "{" << std::endl;
+    os << "    typedef dastrie::trie<" << trie_value_type_name(value) << ", "
+       << (opt.compact ? "dastrie::doublearray4_traits" : "dastrie::doublearray5_traits")
+       << "> trie_type;" << std::endl;
+    os << "    if (argc < 3) {" << std::endl;
+    os << "        std::cerr << \"USAGE: \" << argv[0] << \" DB KEYS [ROUNDS]\" << std::endl;" << std::endl;
+    os << "        return 1;" << std::endl;
+    os << "    }" << std::endl;
+    os << "    int rounds = (3 < argc) ? std::atoi(argv[3]) : 100;" << std::endl;
+    os << std::endl;
+    os << "    std::ifstream ifs(argv[1], std::ios::binary);" << std::endl;
+    os << "    trie_type trie;" << std::endl;
+    os << "    if (ifs.fail() || trie.read(ifs) == 0) {" << std::endl;
+    os << "        std::cerr << \"ERROR: Failed to read the database.\" << std::endl;" << std::endl;
+    os << "        return 1;" << std::endl;
+    os << "    }" << std::endl;
+    os << std::endl;
+    os << "    std::vector<std::string> keys;" << std::endl;
+    os << "    std::ifstream kfs(argv[2]);" << std::endl;
+    os << "    for (std::string line;std::getline(kfs, line);) {" << std::endl;
+    os << "        keys.push_back(line.substr(0, line.find('\\t')));" << std::endl;
+    os << "    }" << std::endl;
+    os << std::endl;
+    os << "    size_t hits = 0;" << std::endl;
+    os << "    clock_t start = clock();" << std::endl;
+    os << "    for (int r = 0;r < rounds;++r) {" << std::endl;
+    os << "        for (size_t i = 0;i < keys.size();++i) {" << std::endl;
+    os << "            hits += " << opt.name << "::in(keys[i].c_str());" << std::endl;
+    os << "        }" << std::endl;
+    os << "    }" << std::endl;
+    os << "    clock_t end = clock();" << std::endl;
+    os << "    std::cout << \"Generated code: \" << hits << \" hits, \" <<" << std::endl;
+    os << "        (end - start) / (double)CLOCKS_PER_SEC << \" sec\" << std::endl;" << std::endl;
+    os << std::endl;
+    os << "    hits = 0;" << std::endl;
+    os << "    start = clock();" << std::endl;
+    os << "    for (int r = 0;r < rounds;++r) {" << std::endl;
+    os << "        for (size_t i = 0;i < keys.size();++i) {" << std::endl;
+    os << "            hits += trie.in(keys[i].c_str());" << std::endl;
+    os << "        }" << std::endl;
+    os << "    }" << std::endl;
+    os << "    end = clock();" << std::endl;
+    os << "    std::cout << \"dastrie::trie: \" << hits << \" hits, \" <<" << std::endl;
+    os << "        (end - start) / (double)CLOCKS_PER_SEC << \" sec\" << std::endl;" << std::endl;
+    os << "    return 0;" << std::endl;
+    os << "}" << std::endl;
+}
+
+template <class value_type, class traits_type>
+int codegen(char *text, size_t /*size*/, const char *input, const option& opt)
+{
+    typedef dastrie::builder<char*, value_type, traits_type> builder_type;
+    typedef typename builder_type::record_type record_type;
+
+    std::ostream& es = std::cerr;
+
+    // Count the number of records in the input text.
+    size_t n = count_records(text);
+    if (n == 0) {
+        es << "ERROR: No records in the input data." << std::endl;
+        return 1;
+    }
+
+    // Allocate an array of records.
+    record_type* records = new record_type[n]();
+
+    // Set records from the input text.
+    set_records(records, n, text);
+
+    // Build a double-array trie, from which the code is generated.
+    builder_type builder;
+    try {
+        builder.build(records, records + n);
+    } catch (const typename builder_type::exception& e) {
+        es << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+
+    // Open the output stream.
+    std::ofstream ofs;
+    if (!opt.output.empty()) {
+        ofs.open(opt.output.c_str());
+        if (ofs.fail()) {
+            es << "ERROR: Failed to open the output file." << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& os = opt.output.empty() ? std::cout : ofs;
+
+    value_type value;
+    os << "/*" << std::endl;
+    os << " * Generated by dastrie-codegen from " << input << " (" << n << " records)." << std::endl;
+    os << " * Do not edit this file by hand." << std::endl;
+    os << " */" << std::endl;
+    os << std::endl;
+    os << "#include <cstring>" << std::endl;
+    os << std::endl;
+    os << "struct " << opt.name << std::endl;
+    os << "{" << std::endl;
+    os << "    typedef " << value_type_name(value) << " value_type;" << std::endl;
+    os << std::endl;
+    os << "    static bool in(const char *key)" << std::endl;
+    os << "    {" << std::endl;
+    os << "        value_type value;" << std::endl;
+    os << "        return find(key, value);" << std::endl;
+    os << "    }" << std::endl;
+    os << std::endl;
+    os << "    static bool find(const char *key, value_type& value)" << std::endl;
+    os << "    {" << std::endl;
+    os << "        const unsigned char *p = reinterpret_cast<const unsigned char*>(key);" << std::endl;
+    generator<value_type, traits_type> gen(os, builder);
+    gen.generate(0, dastrie::INITIAL_INDEX, "        ");
+    os << "    }" << std::endl;
+    os << "};" << std::endl;
+
+    if (opt.bench) {
+        output_bench<value_type, traits_type>(os, opt);
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    option opt;
+    int ret = 0;
+    int arg_used = 0;
+    std::ostream& es = std::cerr;
+    std::ostream& os = std::cout;
+
+    // Parse the command-line options.
+    try {
+        arg_used = opt.parse(argv, argc);
+    } catch (const optparse::unrecognized_option& e) {
+        es << "ERROR: unrecognized option: " << e.what() << std::endl;
+        return 1;
+    } catch (const optparse::invalid_value& e) {
+        es << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+
+    // Show the help message and exit.
+    if (opt.help) {
+        os << "DASTrie code generator ";
+        os << DASTRIE_MAJOR_VERSION << "." << DASTRIE_MINOR_VERSION << " ";
+        os << DASTRIE_COPYRIGHT << std::endl;
+        os << std::endl;
+        usage(os, argv[0]);
+        return ret;
+    }
+
+    // Make sure that an input file is specified.
+    if (argc <= arg_used) {
+        es << "ERROR: No input file specified." << std::endl;
+        return 1;
+    }
+
+    // Read the source data.
+    std::streamoff textsize;
+    char *text = read_text(argv[arg_used], textsize);
+    if (text == NULL) {
+        es << "ERROR: Failed to read the input data." << std::endl;
+        return 1;
+    }
+
+    // The layout of the double array does not affect the generated code.
+    switch (opt.type) {
+    case option::TYPE_EMPTY:
+        return codegen<
+            dastrie::empty_type,
+            dastrie::doublearray5_traits
+        >(text, (size_t)textsize, argv[arg_used], opt);
+    case option::TYPE_INT:
+        return codegen<
+            int,
+            dastrie::doublearray5_traits
+        >(text, (size_t)textsize, argv[arg_used], opt);
+    case option::TYPE_DOUBLE:
+        return codegen<
+            double,
+            dastrie::doublearray5_traits
+        >(text, (size_t)textsize, argv[arg_used], opt);
+    case option::TYPE_STRING:
+        return codegen<
+            char*,
+            dastrie::doublearray5_traits
+        >(text, (size_t)textsize, argv[arg_used], opt);
+    }
+
+    return 0;
+}
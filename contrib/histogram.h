@@ -0,0 +1,178 @@
+/*
+ *      A latency histogram for benchmarks.
+ *
+ * Copyright (c) 2008, Naoaki Okazaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Northwestern University, University of Tokyo,
+ *       nor the names of its contributors may be used to endorse or promote
+ *       products derived from this software without specific prior written
+ *       permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* $Id$ */
+
+#ifndef __HISTOGRAM_H__
+#define __HISTOGRAM_H__
+
+#include <vector>
+#include <stdint.h>
+
+/**
+ * A histogram of latencies with a bounded relative error.
+ *
+ *  Values are counted in buckets in the manner of HDR histograms: values
+ *  smaller than 2^precision have their own buckets, and every larger range
+ *  [2^k, 2^(k+1)) is divided into 2^(precision-1) buckets of equal width.
+ *  The relative error of a reported value is thus below 2^(1-precision)
+ *  (less than 1% for the default precision 8) for any magnitude, while
+ *  the histogram uses a fixed number of counters.
+ */
+class histogram
+{
+protected:
+    int m_precision;
+    std::vector<uint64_t> m_counts;
+    uint64_t m_total;
+    uint64_t m_max;
+
+public:
+    /**
+     * Constructs a histogram.
+     *  @param  precision   The number of significant bits of values.
+     */
+    histogram(int precision = 8)
+        : m_precision(precision), m_total(0), m_max(0)
+    {
+        size_t sub = (size_t)1 << m_precision;
+        m_counts.resize(sub + (64 - m_precision) * (sub / 2), 0);
+    }
+
+    /**
+     * Counts a value.
+     *  @param  value       The value.
+     */
+    void record(uint64_t value)
+    {
+        ++m_counts[index(value)];
+        ++m_total;
+        if (m_max < value) {
+            m_max = value;
+        }
+    }
+
+    /**
+     * Adds the counts of another histogram of the same precision.
+     *  @param  rho         The histogram.
+     */
+    void merge(const histogram& rho)
+    {
+        for (size_t i = 0;i < m_counts.size() && i < rho.m_counts.size();++i) {
+            m_counts[i] += rho.m_counts[i];
+        }
+        m_total += rho.m_total;
+        if (m_max < rho.m_max) {
+            m_max = rho.m_max;
+        }
+    }
+
+    /**
+     * Reports the number of values counted.
+     *  @return uint64_t    The number of values.
+     */
+    uint64_t count() const
+    {
+        return m_total;
+    }
+
+    /**
+     * Reports the maximum value counted.
+     *  @return uint64_t    The exact maximum value.
+     */
+    uint64_t max() const
+    {
+        return m_max;
+    }
+
+    /**
+     * Reports the value at a percentile.
+     *  @param  p           The percentile in [0, 100].
+     *  @return uint64_t    The highest value equivalent to the bucket in
+     *                      which the percentile falls; zero if no value
+     *                      has been counted.
+     */
+    uint64_t percentile(double p) const
+    {
+        if (m_total == 0) {
+            return 0;
+        }
+
+        // The rank of the value at the percentile (1-origin).
+        uint64_t rank = (uint64_t)(p / 100. * (double)m_total + 0.5);
+        if (rank < 1) {
+            rank = 1;
+        }
+
+        uint64_t n = 0;
+        for (size_t i = 0;i < m_counts.size();++i) {
+            n += m_counts[i];
+            if (rank <= n) {
+                uint64_t v = highest(i);
+                return v < m_max ? v : m_max;
+            }
+        }
+        return m_max;
+    }
+
+protected:
+    size_t index(uint64_t value) const
+    {
+        uint64_t sub = (uint64_t)1 << m_precision;
+        if (value < sub) {
+            return (size_t)value;
+        }
+
+        // Find the shift that leaves the precision bits of the value.
+        int shift = 0;
+        while (sub <= (value >> shift)) {
+            ++shift;
+        }
+        uint64_t half = sub / 2;
+        uint64_t mantissa = value >> shift;
+        return (size_t)(sub + (shift - 1) * half + (mantissa - half));
+    }
+
+    uint64_t highest(size_t i) const
+    {
+        uint64_t sub = (uint64_t)1 << m_precision;
+        if (i < sub) {
+            return (uint64_t)i;
+        }
+
+        uint64_t half = sub / 2;
+        int shift = (int)((i - sub) / half) + 1;
+        uint64_t mantissa = (i - sub) % half + half;
+        return (mantissa << shift) + (((uint64_t)1 << shift) - 1);
+    }
+};
+
+#endif/*__HISTOGRAM_H__*/
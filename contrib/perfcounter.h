@@ -0,0 +1,239 @@
+/*
+ *      Hardware performance counters for benchmarks.
+ *
+ * Copyright (c) 2008, Naoaki Okazaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Northwestern University, University of Tokyo,
+ *       nor the names of its contributors may be used to endorse or promote
+ *       products derived from this software without specific prior written
+ *       permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* $Id$ */
+
+#ifndef __PERFCOUNTER_H__
+#define __PERFCOUNTER_H__
+
+#include <cstring>
+#include <stdint.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/**
+ * A set of hardware performance counters of the calling thread.
+ *
+ *  On Linux, every event is opened by perf_event_open(2) separately, so
+ *  that the events supported by the processor (and permitted by
+ *  perf_event_paranoid) are counted even if others are not. Counts are
+ *  scaled by the time ratio when the kernel multiplexes the counters. On
+ *  other platforms, or when no event can be opened, available() returns
+ *  \c false and every count is zero.
+ */
+class perf_counters
+{
+public:
+    /// Events counted.
+    enum {
+        INSTRUCTIONS,
+        BRANCH_MISSES,
+        L1D_MISSES,
+        LLC_MISSES,
+        DTLB_MISSES,
+        NUM_EVENTS,
+    };
+
+protected:
+    int m_fd[NUM_EVENTS];
+    uint64_t m_values[NUM_EVENTS];
+
+public:
+    /**
+     * Opens the counters (disabled).
+     */
+    perf_counters()
+    {
+        for (int i = 0;i < NUM_EVENTS;++i) {
+            m_fd[i] = open_event(i);
+            m_values[i] = 0;
+        }
+    }
+
+    /**
+     * Closes the counters.
+     */
+    virtual ~perf_counters()
+    {
+#if defined(__linux__)
+        for (int i = 0;i < NUM_EVENTS;++i) {
+            if (0 <= m_fd[i]) {
+                close(m_fd[i]);
+            }
+        }
+#endif
+    }
+
+    /**
+     * Obtains the name of an event.
+     *  @param  i           The event.
+     *  @return const char* The name.
+     */
+    static const char* name(int i)
+    {
+        static const char *names[NUM_EVENTS] = {
+            "instructions",
+            "branch misses",
+            "L1D misses",
+            "LLC misses",
+            "dTLB misses",
+        };
+        return names[i];
+    }
+
+    /**
+     * Checks whether an event is counted.
+     *  @param  i           The event.
+     *  @return bool        \c true if the event is counted.
+     */
+    bool available(int i) const
+    {
+        return (0 <= m_fd[i]);
+    }
+
+    /**
+     * Checks whether any event is counted.
+     *  @return bool        \c true if at least one event is counted.
+     */
+    bool available() const
+    {
+        for (int i = 0;i < NUM_EVENTS;++i) {
+            if (available(i)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Resets and starts the counters.
+     */
+    void start()
+    {
+#if defined(__linux__)
+        for (int i = 0;i < NUM_EVENTS;++i) {
+            if (0 <= m_fd[i]) {
+                ioctl(m_fd[i], PERF_EVENT_IOC_RESET, 0);
+                ioctl(m_fd[i], PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    /**
+     * Stops the counters and reads the counts.
+     */
+    void stop()
+    {
+#if defined(__linux__)
+        for (int i = 0;i < NUM_EVENTS;++i) {
+            if (0 <= m_fd[i]) {
+                ioctl(m_fd[i], PERF_EVENT_IOC_DISABLE, 0);
+            }
+        }
+        for (int i = 0;i < NUM_EVENTS;++i) {
+            // The count, the time enabled, and the time running.
+            uint64_t data[3] = {0, 0, 0};
+            m_values[i] = 0;
+            if (0 <= m_fd[i] && read(m_fd[i], data, sizeof(data)) == (ssize_t)sizeof(data)) {
+                if (0 < data[2] && data[2] < data[1]) {
+                    m_values[i] = (uint64_t)((double)data[0] * data[1] / data[2]);
+                } else {
+                    m_values[i] = data[0];
+                }
+            }
+        }
+#endif
+    }
+
+    /**
+     * Obtains the count of an event between the last start() and stop().
+     *  @param  i           The event.
+     *  @return uint64_t    The count.
+     */
+    uint64_t value(int i) const
+    {
+        return m_values[i];
+    }
+
+protected:
+    static int open_event(int i)
+    {
+#if defined(__linux__)
+        struct perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        switch (i) {
+        case INSTRUCTIONS:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case BRANCH_MISSES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        case L1D_MISSES:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_L1D |
+                (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        case LLC_MISSES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+        case DTLB_MISSES:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_DTLB |
+                (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        }
+
+        // Count the events of the calling thread on any CPU.
+        return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+        return -1;
+#endif
+    }
+};
+
+#endif/*__PERFCOUNTER_H__*/
@@ -0,0 +1,599 @@
+/*
+ *      A generator of synthetic key sets and query streams for benchmarks.
+ *
+ * Copyright (c) 2008, Naoaki Okazaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Northwestern University, University of Tokyo,
+ *       nor the names of its contributors may be used to endorse or promote
+ *       products derived from this software without specific prior written
+ *       permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* $Id$ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <dastrie.h>
+#include <optparse.h>
+
+class option : public optparse
+{
+public:
+    enum {
+        SHAPE_WORDS,
+        SHAPE_URLS,
+        SHAPE_CJK,
+        SHAPE_BINARY,
+        SHAPE_NGRAMS,
+        SHAPE_PATHS,
+    };
+
+    int shape;
+    size_t num_keys;
+    size_t num_queries;
+    unsigned long seed;
+    double hit_ratio;
+    double skew;
+    bool values;
+    std::string output;
+    std::string queries;
+    bool help;
+
+public:
+    option() :
+        shape(SHAPE_WORDS), num_keys(10000), num_queries(0), seed(1),
+        hit_ratio(1.0), skew(1.0), values(false), help(false)
+    {
+    }
+
+    BEGIN_OPTION_MAP_INLINE()
+        ON_OPTION_WITH_ARG(SHORTOPT('s') || LONGOPT("shape"))
+            if (strcmp(arg, "words") == 0) {
+                shape = SHAPE_WORDS;
+            } else if (strcmp(arg, "urls") == 0) {
+                shape = SHAPE_URLS;
+            } else if (strcmp(arg, "cjk") == 0) {
+                shape = SHAPE_CJK;
+            } else if (strcmp(arg, "binary") == 0) {
+                shape = SHAPE_BINARY;
+            } else if (strcmp(arg, "ngrams") == 0) {
+                shape = SHAPE_NGRAMS;
+            } else if (strcmp(arg, "paths") == 0) {
+                shape = SHAPE_PATHS;
+            } else {
+                std::stringstream ss;
+                ss << "unknown shape specified: " << arg;
+                throw invalid_value(ss.str());
+            }
+
+        ON_OPTION_WITH_ARG(SHORTOPT('n') || LONGOPT("num-keys"))
+            num_keys = (size_t)std::atol(arg);
+            if (num_keys == 0) {
+                throw invalid_value("the number of keys must be positive");
+            }
+
+        ON_OPTION_WITH_ARG(SHORTOPT('S') || LONGOPT("seed"))
+            seed = std::strtoul(arg, NULL, 10);
+
+        ON_OPTION(SHORTOPT('v') || LONGOPT("values"))
+            values = true;
+
+        ON_OPTION_WITH_ARG(SHORTOPT('o') || LONGOPT("output"))
+            output = arg;
+
+        ON_OPTION_WITH_ARG(SHORTOPT('q') || LONGOPT("queries"))
+            queries = arg;
+
+        ON_OPTION_WITH_ARG(SHORTOPT('m') || LONGOPT("num-queries"))
+            num_queries = (size_t)std::atol(arg);
+
+        ON_OPTION_WITH_ARG(SHORTOPT('r') || LONGOPT("hit-ratio"))
+            hit_ratio = std::atof(arg);
+            if (hit_ratio < 0 || 1 < hit_ratio) {
+                std::stringstream ss;
+                ss << "the hit ratio must be in [0, 1]: " << arg;
+                throw invalid_value(ss.str());
+            }
+
+        ON_OPTION_WITH_ARG(SHORTOPT('z') || LONGOPT("skew"))
+            skew = std::atof(arg);
+            if (skew < 0) {
+                std::stringstream ss;
+                ss << "the skew must not be negative: " << arg;
+                throw invalid_value(ss.str());
+            }
+
+        ON_OPTION(SHORTOPT('h') || LONGOPT("help"))
+            help = true;
+
+    END_OPTION_MAP()
+};
+
+static void usage(std::ostream& os, const char *argv0)
+{
+    os << "USAGE: " << argv0 << " [OPTIONS]" << std::endl;
+    os << "This utility generates a synthetic set of keys (sorted in dictionary order) and" << std::endl;
+    os << "a stream of queries to the keys. The output depends only on the options, so that" << std::endl;
+    os << "benchmarks are reproducible on any machine without external corpora." << std::endl;
+    os << std::endl;
+    os << "OPTIONS:" << std::endl;
+    os << "  -s, --shape=SHAPE  specify the shape of keys:" << std::endl;
+    os << "      words              English-like words [DEFAULT]" << std::endl;
+    os << "      urls               URLs sharing hosts chosen with a Zipfian distribution" << std::endl;
+    os << "      cjk                UTF-8 strings of CJK ideographs and hiragana" << std::endl;
+    os << "      binary             random byte strings written in hexadecimal, which can" << std::endl;
+    os << "                         be stored by dastrie-build -b" << std::endl;
+    os << "      ngrams             sequences of 1 to 5 words separated by spaces" << std::endl;
+    os << "      paths              long file paths" << std::endl;
+    os << "  -n, --num-keys=N   generate N distinct keys [DEFAULT=10000]" << std::endl;
+    os << "  -S, --seed=N       specify the seed of the random numbers [DEFAULT=1]" << std::endl;
+    os << "  -v, --values       append a TAB and the rank of each key (0 for the key most" << std::endl;
+    os << "                     frequently queried) as an integer value" << std::endl;
+    os << "  -o, --output=FILE  write the keys to FILE; by default, this utility writes the" << std::endl;
+    os << "                     keys to STDOUT" << std::endl;
+    os << "  -q, --queries=FILE write a stream of queries to FILE" << std::endl;
+    os << "  -m, --num-queries=N" << std::endl;
+    os << "                     generate N queries [DEFAULT=the number of keys]" << std::endl;
+    os << "  -r, --hit-ratio=R  let the fraction R of queries be keys in the set; the others" << std::endl;
+    os << "                     are near misses derived from the keys [DEFAULT=1]" << std::endl;
+    os << "  -z, --skew=S       choose the keys to be queried with a Zipfian distribution of" << std::endl;
+    os << "                     the exponent S over their ranks; 0 is uniform [DEFAULT=1]" << std::endl;
+    os << "  -h, --help         show this help message and exit" << std::endl;
+}
+
+/**
+ * A pseudo-random number generator (SplitMix64).
+ *  This is implemented here rather than with the standard library, whose
+ *  distributions may yield different sequences on different platforms.
+ */
+class random_source
+{
+protected:
+    uint64_t m_state;
+
+public:
+    random_source(uint64_t seed) : m_state(seed)
+    {
+    }
+
+    uint64_t next()
+    {
+        uint64_t z = (m_state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    /// A uniform integer in [0, n).
+    size_t uniform(size_t n)
+    {
+        return (size_t)(next() % n);
+    }
+
+    /// A uniform integer in [0, n) biased toward zero.
+    size_t biased(size_t n)
+    {
+        return std::min(uniform(n), uniform(n));
+    }
+
+    /// A uniform real number in [0, 1).
+    double real()
+    {
+        return (double)(next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+};
+
+/**
+ * A sampler of ranks [0, n) with a Zipfian distribution.
+ */
+class zipf
+{
+protected:
+    std::vector<double> m_cdf;
+
+public:
+    zipf(size_t n = 1, double s = 1.0)
+    {
+        init(n, s);
+    }
+
+    void init(size_t n, double s)
+    {
+        double sum = 0.;
+        m_cdf.resize(n);
+        for (size_t i = 0;i < n;++i) {
+            sum += 1. / std::pow((double)(i + 1), s);
+            m_cdf[i] = sum;
+        }
+        for (size_t i = 0;i < n;++i) {
+            m_cdf[i] /= sum;
+        }
+    }
+
+    size_t operator()(random_source& rnd) const
+    {
+        double u = rnd.real();
+        size_t i = (size_t)(std::upper_bound(m_cdf.begin(), m_cdf.end(), u) - m_cdf.begin());
+        return i < m_cdf.size() ? i : m_cdf.size() - 1;
+    }
+};
+
+class keygen
+{
+protected:
+    int m_shape;
+    random_source& m_rnd;
+    std::vector<std::string> m_vocab;
+    zipf m_vocab_zipf;
+    std::vector<std::string> m_hosts;
+    zipf m_host_zipf;
+    zipf m_cjk_zipf;
+
+public:
+    keygen(int shape, random_source& rnd, size_t num_keys)
+        : m_shape(shape), m_rnd(rnd)
+    {
+        // A vocabulary for the shapes composed of words.
+        if (shape == option::SHAPE_URLS ||
+            shape == option::SHAPE_NGRAMS ||
+            shape == option::SHAPE_PATHS) {
+            size_t n = std::max<size_t>(1000, (size_t)std::sqrt((double)num_keys) * 20);
+            vocabulary(m_vocab, n);
+            m_vocab_zipf.init(m_vocab.size(), 1.0);
+        }
+
+        // Hosts shared by URLs.
+        if (shape == option::SHAPE_URLS) {
+            static const char *tlds[] = {
+                ".com", ".com", ".com", ".net", ".org", ".jp", ".de", ".co.uk", ".io",
+            };
+            std::vector<std::string> names;
+            vocabulary(names, std::max<size_t>(16, num_keys / 50));
+            for (size_t i = 0;i < names.size();++i) {
+                std::string host = (m_rnd.real() < 0.6) ? "http://www." : "http://";
+                host += names[i];
+                host += tlds[m_rnd.uniform(sizeof(tlds) / sizeof(tlds[0]))];
+                m_hosts.push_back(host);
+            }
+            m_host_zipf.init(m_hosts.size(), 1.0);
+        }
+
+        // Characters of CJK strings in the order of frequency.
+        m_cjk_zipf.init(3500, 1.0);
+    }
+
+    std::string generate()
+    {
+        switch (m_shape) {
+        case option::SHAPE_URLS:
+            return url();
+        case option::SHAPE_CJK:
+            return cjk();
+        case option::SHAPE_BINARY:
+            return binary();
+        case option::SHAPE_NGRAMS:
+            return ngram();
+        case option::SHAPE_PATHS:
+            return path();
+        default:
+            return word();
+        }
+    }
+
+    /**
+     * Derives a key that resembles a given key (e.g., a near miss).
+     */
+    std::string mutate(const std::string& key)
+    {
+        if (m_rnd.real() < 0.5) {
+            return generate();
+        }
+
+        std::string str = key;
+        switch (m_shape) {
+        case option::SHAPE_BINARY:
+            str += (char)m_rnd.uniform(256);
+            break;
+        case option::SHAPE_CJK:
+            str += cjk_char();
+            break;
+        default:
+            str += (char)('a' + m_rnd.uniform(26));
+            break;
+        }
+        return str;
+    }
+
+protected:
+    void vocabulary(std::vector<std::string>& vocab, size_t n)
+    {
+        std::map<std::string, bool> seen;
+        for (size_t trials = 0;vocab.size() < n && trials < n * 100;++trials) {
+            std::string w = word();
+            if (seen.insert(std::make_pair(w, true)).second) {
+                vocab.push_back(w);
+            }
+        }
+    }
+
+    std::string word()
+    {
+        // Syllables and suffixes roughly in the order of frequency.
+        static const char *onsets[] = {
+            "", "t", "s", "r", "n", "l", "d", "m", "c", "p", "b", "h", "f", "g",
+            "w", "st", "th", "pr", "tr", "ch", "sh", "br", "cr", "gr", "pl", "fl",
+            "dr", "cl", "sl", "wh", "str", "sp", "k", "v", "j", "qu", "z",
+        };
+        static const char *vowels[] = {
+            "e", "a", "o", "i", "u", "ea", "y", "ou", "ee", "ai", "oo", "ie", "io",
+        };
+        static const char *codas[] = {
+            "", "", "", "n", "r", "s", "t", "l", "d", "m", "nt", "st", "ng", "ll",
+            "ss", "ck", "rd", "nd", "rt", "x",
+        };
+        static const char *suffixes[] = {
+            "", "", "", "", "", "s", "ed", "ing", "er", "ly", "es", "tion", "al",
+            "ness", "ment", "able", "ity",
+        };
+
+        // The number of syllables.
+        double r = m_rnd.real();
+        int n = (r < 0.35) ? 1 : (r < 0.75) ? 2 : (r < 0.93) ? 3 : 4;
+
+        std::string str;
+        for (int i = 0;i < n;++i) {
+            str += onsets[m_rnd.biased(sizeof(onsets) / sizeof(onsets[0]))];
+            str += vowels[m_rnd.biased(sizeof(vowels) / sizeof(vowels[0]))];
+            str += codas[m_rnd.biased(sizeof(codas) / sizeof(codas[0]))];
+        }
+        str += suffixes[m_rnd.biased(sizeof(suffixes) / sizeof(suffixes[0]))];
+        return str;
+    }
+
+    const std::string& vocab_word()
+    {
+        return m_vocab[m_vocab_zipf(m_rnd)];
+    }
+
+    std::string url()
+    {
+        static const char *endings[] = {"", "/", ".html", ".php", "?id="};
+
+        std::string str = m_hosts[m_host_zipf(m_rnd)];
+        size_t depth = m_rnd.biased(6);
+        for (size_t i = 0;i < depth;++i) {
+            str += '/';
+            str += vocab_word();
+        }
+
+        size_t e = m_rnd.uniform(sizeof(endings) / sizeof(endings[0]));
+        str += endings[e];
+        if (e == 4) {
+            std::stringstream ss;
+            ss << m_rnd.uniform(100000);
+            str += ss.str();
+        }
+        return str;
+    }
+
+    static void encode_utf8(std::string& str, uint32_t c)
+    {
+        if (c < 0x80) {
+            str += (char)c;
+        } else if (c < 0x800) {
+            str += (char)(0xC0 | (c >> 6));
+            str += (char)(0x80 | (c & 0x3F));
+        } else {
+            str += (char)(0xE0 | (c >> 12));
+            str += (char)(0x80 | ((c >> 6) & 0x3F));
+            str += (char)(0x80 | (c & 0x3F));
+        }
+    }
+
+    std::string cjk_char()
+    {
+        std::string str;
+        if (m_rnd.real() < 0.2) {
+            // Hiragana (U+3041 to U+3093).
+            encode_utf8(str, 0x3041 + (uint32_t)m_rnd.uniform(0x53));
+        } else {
+            // Frequent ideographs, scattered over U+4E00 to U+9FFF.
+            uint32_t rank = (uint32_t)m_cjk_zipf(m_rnd);
+            encode_utf8(str, 0x4E00 + (rank * 2654435761U) % 0x5200);
+        }
+        return str;
+    }
+
+    std::string cjk()
+    {
+        double r = m_rnd.real();
+        int n = (r < 0.1) ? 1 : (r < 0.5) ? 2 : (r < 0.75) ? 3 : (r < 0.9) ? 4 : 5 + (int)m_rnd.uniform(4);
+
+        std::string str;
+        for (int i = 0;i < n;++i) {
+            str += cjk_char();
+        }
+        return str;
+    }
+
+    std::string binary()
+    {
+        std::string str;
+        size_t n = 4 + m_rnd.uniform(17);
+        for (size_t i = 0;i < n;++i) {
+            str += (char)m_rnd.uniform(256);
+        }
+        return str;
+    }
+
+    std::string ngram()
+    {
+        double r = m_rnd.real();
+        int n = (r < 0.15) ? 1 : (r < 0.45) ? 2 : (r < 0.75) ? 3 : (r < 0.9) ? 4 : 5;
+
+        std::string str = vocab_word();
+        for (int i = 1;i < n;++i) {
+            str += ' ';
+            str += vocab_word();
+        }
+        return str;
+    }
+
+    std::string path()
+    {
+        static const char *roots[] = {
+            "/usr/share", "/home/user", "/var/lib", "/opt", "/srv/data", "/usr/local/lib",
+        };
+        static const char *extensions[] = {
+            ".txt", ".h", ".cpp", ".json", ".log", ".so", ".png", "",
+        };
+
+        std::string str = roots[m_rnd.biased(sizeof(roots) / sizeof(roots[0]))];
+        size_t depth = 3 + m_rnd.uniform(10);
+        for (size_t i = 0;i < depth;++i) {
+            str += '/';
+            str += vocab_word();
+        }
+        str += extensions[m_rnd.uniform(sizeof(extensions) / sizeof(extensions[0]))];
+        return str;
+    }
+};
+
+static std::string encode_hex(const std::string& bytes)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string str;
+    for (size_t i = 0;i < bytes.length();++i) {
+        str += digits[(uint8_t)bytes[i] >> 4];
+        str += digits[(uint8_t)bytes[i] & 0x0F];
+    }
+    return str;
+}
+
+static int generate(const option& opt, std::ostream& os)
+{
+    typedef std::map<std::string, size_t> keyset_type;
+
+    std::ostream& es = std::cerr;
+    random_source rnd((uint64_t)opt.seed);
+    keygen gen(opt.shape, rnd, opt.num_keys);
+    bool hex = (opt.shape == option::SHAPE_BINARY);
+
+    // Generate distinct keys; the rank of a key is its order of generation.
+    keyset_type keys;
+    std::vector<const std::string*> ranks;
+    for (size_t trials = 0;ranks.size() < opt.num_keys;++trials) {
+        if (opt.num_keys * 100 + 1000 < trials) {
+            es << "ERROR: Failed to generate " << opt.num_keys << " distinct keys." << std::endl;
+            return 1;
+        }
+        std::pair<keyset_type::iterator, bool> ret =
+            keys.insert(std::make_pair(gen.generate(), ranks.size()));
+        if (ret.second) {
+            ranks.push_back(&ret.first->first);
+        }
+    }
+
+    // Write the keys in dictionary order.
+    for (keyset_type::const_iterator it = keys.begin();it != keys.end();++it) {
+        os << (hex ? encode_hex(it->first) : it->first);
+        if (opt.values) {
+            os << '\t' << it->second;
+        }
+        os << '\n';
+    }
+
+    // Write a stream of queries.
+    if (!opt.queries.empty()) {
+        std::ofstream ofs(opt.queries.c_str());
+        if (ofs.fail()) {
+            es << "ERROR: Failed to open the query file." << std::endl;
+            return 1;
+        }
+
+        zipf skew(ranks.size(), opt.skew);
+        size_t n = (0 < opt.num_queries) ? opt.num_queries : opt.num_keys;
+        for (size_t i = 0;i < n;++i) {
+            const std::string& key = *ranks[skew(rnd)];
+            if (rnd.real() < opt.hit_ratio) {
+                ofs << (hex ? encode_hex(key) : key) << '\n';
+            } else {
+                // Derive a near miss from the key.
+                std::string query = gen.mutate(key);
+                for (int t = 0;t < 100 && keys.find(query) != keys.end();++t) {
+                    query = gen.mutate(key);
+                }
+                ofs << (hex ? encode_hex(query) : query) << '\n';
+            }
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    option opt;
+    int ret = 0;
+    std::ostream& es = std::cerr;
+    std::ostream& os = std::cout;
+
+    // Parse the command-line options.
+    try {
+        opt.parse(argv, argc);
+    } catch (const optparse::unrecognized_option& e) {
+        es << "ERROR: unrecognized option: " << e.what() << std::endl;
+        return 1;
+    } catch (const optparse::invalid_value& e) {
+        es << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+
+    // Show the help message and exit.
+    if (opt.help) {
+        os << "DASTrie key generator ";
+        os << DASTRIE_MAJOR_VERSION << "." << DASTRIE_MINOR_VERSION << " ";
+        os << DASTRIE_COPYRIGHT << std::endl;
+        os << std::endl;
+        usage(os, argv[0]);
+        return ret;
+    }
+
+    // Write the keys to the output file or STDOUT.
+    if (!opt.output.empty()) {
+        std::ofstream ofs(opt.output.c_str());
+        if (ofs.fail()) {
+            es << "ERROR: Failed to open the output file." << std::endl;
+            return 1;
+        }
+        return generate(opt, ofs);
+    }
+    return generate(opt, os);
+}
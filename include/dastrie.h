@@ -40,15 +40,35 @@ http://www.open-std.org/jtc1/sc22/wg21/docs/lwg-defects.html#69
 #define __DASTRIE_H__
 
 #include <algorithm>
+#include <cstdlib>
 #include <cstring>
+#include <ctime>
+#include <fstream>
 #include <map>
 #include <iostream>
 #include <set>
+#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <vector>
 #include <stdint.h>
 
+#if defined(__linux__)
+#include <sched.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && 1900 <= _MSC_VER)
+#include <chrono>
+#include <mutex>
+#include <thread>
+#endif
+
 #define DASTRIE_MAJOR_VERSION   1
 #define DASTRIE_MINOR_VERSION   1
 #define DASTRIE_COPYRIGHT       "Copyright (c) 2008,2009, Naoaki Okazaki"
@@ -79,6 +99,27 @@ enum {
     SDAT_CHUNKSIZE = 16,
 };
 
+/**
+ * Flags stored in a "FLAG" chunk.
+ */
+enum {
+    /// Keys are byte strings delimited by length, which may contain null
+    /// characters; a key ends at a leaf or at a node listed in "TERM".
+    FLAG_BINARY = 0x00000001,
+};
+
+/**
+ * Operations in a query trace.
+ */
+enum {
+    /// trie::in().
+    TRACE_IN = 0,
+    /// trie::find() or trie::get().
+    TRACE_FIND = 1,
+    /// trie::prefix().
+    TRACE_PREFIX = 2,
+};
+
 
 
 /**
@@ -141,6 +182,23 @@ struct doublearray4_traits
     {
         elem = (elem & 0xFFFFFF00) | (element_type)v;
     }
+
+    /// The number of bytes of a key postfix stored in a leaf element.
+    inline static int inline_size()
+    {
+        return 0;
+    }
+
+    /// Gets the bytes of a key postfix stored in a leaf element.
+    inline static const uint8_t* get_inline(const element_type& /*elem*/)
+    {
+        return NULL;
+    }
+
+    /// Sets the bytes of a key postfix stored in a leaf element.
+    inline static void set_inline(element_type& /*elem*/, const uint8_t* /*p*/)
+    {
+    }
 };
 
 /**
@@ -210,8 +268,205 @@ struct doublearray5_traits
     {
         elem.v[4] = v;
     }
+
+    /// The number of bytes of a key postfix stored in a leaf element.
+    inline static int inline_size()
+    {
+        return 0;
+    }
+
+    /// Gets the bytes of a key postfix stored in a leaf element.
+    inline static const uint8_t* get_inline(const element_type& /*elem*/)
+    {
+        return NULL;
+    }
+
+    /// Sets the bytes of a key postfix stored in a leaf element.
+    inline static void set_inline(element_type& /*elem*/, const uint8_t* /*p*/)
+    {
+    }
+};
+
+/**
+ * Attributes and operations for a double array (8 bytes/element).
+ *
+ *  In addition to BASE and CHECK, a leaf element stores the first three
+ *  bytes of the key postfix of the record (including the terminator of
+ *  a postfix shorter than three bytes) for text keys. A look-up compares
+ *  a query with these bytes first, and reads the TAIL only when the
+ *  postfix is longer than two bytes and the three bytes match. The TAIL
+ *  still stores every postfix, so that the other operations are unchanged.
+ */
+struct doublearray8_traits
+{
+    /// A type that represents an element of a base array.
+    typedef int32_t base_type;
+    /// A type that represents an element of a check array.
+    typedef uint8_t check_type;
+    /// A type that represents an element of a double array.
+    struct element_type
+    {
+        // BASE: v[0:4], CHECK: v[4], postfix: v[5:8]
+        uint8_t v[8];
+    };
+
+    /// The chunk ID.
+    inline static const char *chunk_id()
+    {
+        static const char *id = "SDA8";
+        return id;
+    }
+
+    /// Gets the minimum number of BASE values.
+    inline static base_type min_base()
+    {
+        return 1;
+    }
+
+    /// Gets the maximum number of BASE values.
+    inline static base_type max_base()
+    {
+        return 0x7FFFFFFF;
+    }
+
+    /// The default value of an element.
+    inline static element_type default_value()
+    {
+        static const element_type def = {{0, 0, 0, 0, 0, 0, 0, 0}};
+        return def;
+    }
+
+    /// Gets the BASE value of an element.
+    inline static base_type get_base(const element_type& elem)
+    {
+        base_type b;
+        std::memcpy(&b, &elem.v[0], sizeof(b));
+        return b;
+    }
+
+    /// Gets the CHECK value of an element.
+    inline static check_type get_check(const element_type& elem)
+    {
+        return elem.v[4];
+    }
+
+    /// Sets the BASE value of an element.
+    inline static void set_base(element_type& elem, base_type v)
+    {
+        std::memcpy(&elem.v[0], &v, sizeof(v));
+    }
+
+    /// Sets the CHECK value of an element.
+    inline static void set_check(element_type& elem, check_type v)
+    {
+        elem.v[4] = v;
+    }
+
+    /// The number of bytes of a key postfix stored in a leaf element.
+    inline static int inline_size()
+    {
+        return 3;
+    }
+
+    /// Gets the bytes of a key postfix stored in a leaf element.
+    inline static const uint8_t* get_inline(const element_type& elem)
+    {
+        return &elem.v[5];
+    }
+
+    /// Sets the bytes of a key postfix stored in a leaf element.
+    inline static void set_inline(element_type& elem, const uint8_t* p)
+    {
+        std::memcpy(&elem.v[5], p, 3);
+    }
+};
+
+
+/**
+ * Encodings of values stored in leaf elements.
+ *  A leaf whose key postfix is empty can store the value of its record in
+ *  the BASE instead of the TAIL, when the value type has a specialization
+ *  of this class that maps a value to a non-negative integer (code). The
+ *  primary template disables this for any other type.
+ *  @param  value_tmpl  The type of values.
+ */
+template <class value_tmpl>
+struct inline_value_traits
+{
+    /// Whether values of the type can be stored in leaf elements.
+    enum { available = 0 };
+
+    /// Encodes a value into a code; \c false if the value has no code.
+    inline static bool encode(const value_tmpl& /*value*/, uint32_t& /*code*/)
+    {
+        return false;
+    }
+
+    /// Decodes a code into a value.
+    inline static void decode(uint32_t /*code*/, value_tmpl& /*value*/)
+    {
+    }
+};
+
+/**
+ * Encodings of signed or unsigned integer values stored in leaf elements.
+ *  Signed values are encoded in the zigzag order (0, -1, 1, -2, 2, ...)
+ *  so that values close to zero have small codes.
+ *  @param  integer_tmpl    The integer type.
+ *  @param  is_signed       \c true if the type is signed.
+ */
+template <class integer_tmpl, bool is_signed>
+struct inline_integer_traits
+{
+    enum { available = 1 };
+
+    inline static bool encode(const integer_tmpl& value, uint32_t& code)
+    {
+        if (0xFFFFFFFFu < (uint64_t)value) {
+            return false;
+        }
+        code = (uint32_t)value;
+        return true;
+    }
+
+    inline static void decode(uint32_t code, integer_tmpl& value)
+    {
+        value = (integer_tmpl)code;
+    }
+};
+
+template <class integer_tmpl>
+struct inline_integer_traits<integer_tmpl, true>
+{
+    enum { available = 1 };
+
+    inline static bool encode(const integer_tmpl& value, uint32_t& code)
+    {
+        int64_t v = (int64_t)value;
+        uint64_t z = (v < 0) ? ((uint64_t)(-(v + 1)) << 1) | 1 : ((uint64_t)v << 1);
+        if (0xFFFFFFFFu < z) {
+            return false;
+        }
+        code = (uint32_t)z;
+        return true;
+    }
+
+    inline static void decode(uint32_t code, integer_tmpl& value)
+    {
+        int64_t v = (code & 1) ? -(int64_t)(code >> 1) - 1 : (int64_t)(code >> 1);
+        value = (integer_tmpl)v;
+    }
 };
 
+template <> struct inline_value_traits<signed char> : public inline_integer_traits<signed char, true> {};
+template <> struct inline_value_traits<unsigned char> : public inline_integer_traits<unsigned char, false> {};
+template <> struct inline_value_traits<short> : public inline_integer_traits<short, true> {};
+template <> struct inline_value_traits<unsigned short> : public inline_integer_traits<unsigned short, false> {};
+template <> struct inline_value_traits<int> : public inline_integer_traits<int, true> {};
+template <> struct inline_value_traits<unsigned int> : public inline_integer_traits<unsigned int, false> {};
+template <> struct inline_value_traits<long> : public inline_integer_traits<long, true> {};
+template <> struct inline_value_traits<unsigned long> : public inline_integer_traits<unsigned long, false> {};
+
 
 
 /**
@@ -290,6 +545,12 @@ public:
         return m_size;
     }
 
+    /// Checks whether the memory block is managed by this instance.
+    inline bool own() const
+    {
+        return m_own;
+    }
+
     /// Assigns a new array from an existing memory block.
     inline void assign(value_type* block, size_type size, bool own = false)
     {
@@ -307,6 +568,15 @@ public:
         m_own = own;
     }
 
+    /// Allocates a new memory block managed by this instance.
+    inline void allocate(size_type size)
+    {
+        free();
+        m_block = new value_type[size];
+        m_size = size;
+        m_own = true;
+    }
+
     /// Destroy the array.
     inline void free()
     {
@@ -322,6 +592,149 @@ public:
 
 
 
+/**
+ * An extendable array stored in fixed-size segments.
+ *  Unlike std::vector, this array never moves the existing elements when it
+ *  grows; it just allocates new segments. Thus, growth costs no copy, and
+ *  the peak memory stays close to the size of the array.
+ *  @param  value_tmpl      The element type to be stored in the array.
+ *  @param  segment_bits    The number of elements in a segment in log2.
+ */
+template <class value_tmpl, int segment_bits = 16>
+class segmented_array
+{
+public:
+    /// The type that represents elements of the array.
+    typedef value_tmpl value_type;
+    /// The type that represents the size of the array.
+    typedef size_t size_type;
+
+    enum {
+        /// The number of elements in a segment.
+        SEGMENT_SIZE = 1 << segment_bits,
+    };
+
+protected:
+    typedef std::vector<value_type*> segments_type;
+
+    segments_type   m_segments;
+    size_type       m_size;
+
+public:
+    /// Constructs an array.
+    segmented_array() : m_size(0)
+    {
+    }
+
+    /// Constructs an array from another array instance.
+    segmented_array(const segmented_array& rho) : m_size(0)
+    {
+        *this = rho;
+    }
+
+    /// Destructs an array.
+    virtual ~segmented_array()
+    {
+        clear();
+    }
+
+    /// Assigns the copy of another array to this instance.
+    segmented_array& operator=(const segmented_array& rho)
+    {
+        if (this != &rho) {
+            clear();
+            resize(rho.m_size);
+            for (size_type i = 0;i < m_segments.size();++i) {
+                std::copy(
+                    rho.m_segments[i],
+                    rho.m_segments[i] + rho.segment_size(i),
+                    m_segments[i]);
+            }
+        }
+        return *this;
+    }
+
+    /// Obtains a read/write access to an element in the array.
+    inline value_type& operator[](size_type i)
+    {
+        return m_segments[i >> segment_bits][i & (SEGMENT_SIZE-1)];
+    }
+
+    /// Obtains a read-only access to an element in the array.
+    inline const value_type& operator[](size_type i) const
+    {
+        return m_segments[i >> segment_bits][i & (SEGMENT_SIZE-1)];
+    }
+
+    /// Reports the size of the array.
+    inline size_type size() const
+    {
+        return m_size;
+    }
+
+    /// Resizes the array, filling new elements with the value.
+    void resize(size_type size, const value_type& value = value_type())
+    {
+        size_type n = (size + SEGMENT_SIZE - 1) >> segment_bits;
+
+        // Release segments that are no longer used.
+        while (n < m_segments.size()) {
+            delete[] m_segments.back();
+            m_segments.pop_back();
+        }
+
+        // Allocate new segments.
+        while (m_segments.size() < n) {
+            m_segments.push_back(new value_type[SEGMENT_SIZE]);
+        }
+
+        for (size_type i = m_size;i < size;++i) {
+            (*this)[i] = value;
+        }
+        m_size = size;
+    }
+
+    /// Removes all elements and releases the memory.
+    void clear()
+    {
+        for (size_type i = 0;i < m_segments.size();++i) {
+            delete[] m_segments[i];
+        }
+        m_segments.clear();
+        m_size = 0;
+    }
+
+    /// Reports the number of segments.
+    inline size_type num_segments() const
+    {
+        return m_segments.size();
+    }
+
+    /// Obtains a read-only access to a segment.
+    inline const value_type* segment(size_type i) const
+    {
+        return m_segments[i];
+    }
+
+    /// Reports the number of elements used in a segment.
+    inline size_type segment_size(size_type i) const
+    {
+        size_type first = i << segment_bits;
+        return std::min((size_type)SEGMENT_SIZE, m_size - first);
+    }
+
+    /// Copies the elements to a contiguous memory block.
+    void copy(value_type* block) const
+    {
+        for (size_type i = 0;i < m_segments.size();++i) {
+            std::copy(m_segments[i], m_segments[i] + segment_size(i), block);
+            block += segment_size(i);
+        }
+    }
+};
+
+
+
 /**
  * A writer class for a tail array.
  */
@@ -513,6 +926,34 @@ public:
         m_cont.assign(const_cast<element_type*>(ptr), size, own);
     }
 
+    /**
+     * Obtains a read-only access to the pointer of the tail array.
+     *  @return const element_type* The pointer to the tail array.
+     */
+    inline const element_type* block() const
+    {
+        return &m_cont[0];
+    }
+
+    /**
+     * Reports the size of the tail array.
+     *  @return size_type   The size, in bytes, of the tail array.
+     */
+    inline size_type bytes() const
+    {
+        return sizeof(element_type) * m_cont.size();
+    }
+
+    /**
+     * Checks whether the memory block is managed by this instance.
+     *  @return bool        \c true if the tail array was copied to a memory
+     *                      block of this instance, \c false otherwise.
+     */
+    inline bool own() const
+    {
+        return m_cont.own();
+    }
+
     /**
      * Moves the read position in the tail array.
      *  @param  offset      The offset for the new read position.
@@ -545,12 +986,26 @@ public:
     /**
      * Exact match for the string from the current position.
      *  @param  str         The pointer to the string to be compared.
+     *  @param  fold        The folding map applied to the bytes of str, or
+     *                      \c NULL to compare the bytes as they are.
      *  @return bool        \c true if the string starting from the current
      *                      position is identical to the give string str;
      *                      \c false otherwise.
      */
-    inline bool match_string(const char *str)
+    inline bool match_string(const char *str, const uint8_t* fold = NULL)
     {
+        if (fold != NULL) {
+            for (size_type i = m_offset;i < m_cont.size();++i, ++str) {
+                if (m_cont[i] != fold[(uint8_t)*str]) {
+                    return false;
+                }
+                if (*str == 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
         size_type length = std::strlen(str) + 1;
         if (m_offset + length <= m_cont.size()) {
             if (std::memcmp(&m_cont[m_offset], str, length) == 0) {
@@ -563,12 +1018,26 @@ public:
     /**
      * Prefix match for the string from the current position.
      *  @param  str         The pointer to the string to be compared.
+     *  @param  fold        The folding map applied to the bytes of str, or
+     *                      \c NULL to compare the bytes as they are.
      *  @return bool        \c true if the give string str begins with the
      *                      substring starting from the current position;
      *                      \c false otherwise.
      */
-    inline bool match_string_partial(const char *str)
+    inline bool match_string_partial(const char *str, const uint8_t* fold = NULL)
     {
+        if (fold != NULL) {
+            for (size_type i = m_offset;i < m_cont.size();++i, ++str) {
+                if (m_cont[i] == 0) {
+                    return true;
+                }
+                if (m_cont[i] != fold[(uint8_t)*str]) {
+                    return false;
+                }
+            }
+            return false;
+        }
+
         size_type length = std::strlen(
             reinterpret_cast<const char *>(&m_cont[m_offset]));
         if (m_offset + length + 1 <= m_cont.size()) {
@@ -633,6 +1102,93 @@ public:
 
 
 
+/**
+ * Identifies the format of the double array stored in a trie.
+ *  @param  is              The input stream positioned at a "SDAT" chunk.
+ *                          The read position is restored on return.
+ *  @return int             The size, in bytes, of a double-array element
+ *                          (4 for "SDA4", 5 for "SDA5", 8 for "SDA8"), or
+ *                          zero if the stream does not contain a double array.
+ */
+inline int probe(std::istream& is)
+{
+    int width = 0;
+    char chunk[4];
+    uint32_t size, total_size;
+    std::istream::pos_type offset = is.tellg();
+
+    // Read the "SDAT" chunk.
+    is.read(chunk, 4);
+    is.read(reinterpret_cast<char*>(&total_size), sizeof(total_size));
+    if (!is.fail() && std::strncmp(chunk, "SDAT", 4) == 0) {
+        // Loop for child chunks.
+        std::streamoff pos = SDAT_CHUNKSIZE;
+        while (pos + CHUNKSIZE <= (std::streamoff)total_size) {
+            is.seekg(offset + pos);
+            is.read(chunk, 4);
+            is.read(reinterpret_cast<char*>(&size), sizeof(size));
+            if (is.fail() || size < CHUNKSIZE) {
+                break;
+            }
+            if (std::strncmp(chunk, "SDA4", 4) == 0) {
+                width = 4;
+                break;
+            } else if (std::strncmp(chunk, "SDA5", 4) == 0) {
+                width = 5;
+                break;
+            } else if (std::strncmp(chunk, "SDA8", 4) == 0) {
+                width = 8;
+                break;
+            }
+            pos += size;
+        }
+    }
+
+    is.clear();
+    is.seekg(offset);
+    return width;
+}
+
+/**
+ * Identifies the format of the double array stored in a memory block.
+ *  @param  block           The pointer to a "SDAT" chunk.
+ *  @param  size            The size, in bytes, of the memory block.
+ *  @return int             The size, in bytes, of a double-array element
+ *                          (4 for "SDA4", 5 for "SDA5", 8 for "SDA8"), or
+ *                          zero if the block does not contain a double array.
+ */
+inline int probe(const char *block, size_t size)
+{
+    uint32_t chunk_size, total_size;
+    if (size < SDAT_CHUNKSIZE || std::strncmp(block, "SDAT", 4) != 0) {
+        return 0;
+    }
+    std::memcpy(&total_size, block + 4, sizeof(total_size));
+    if (size < total_size) {
+        return 0;
+    }
+
+    // Loop for child chunks.
+    size_t pos = SDAT_CHUNKSIZE;
+    while (pos + CHUNKSIZE <= total_size) {
+        std::memcpy(&chunk_size, block + pos + 4, sizeof(chunk_size));
+        if (chunk_size < CHUNKSIZE) {
+            break;
+        }
+        if (std::strncmp(block + pos, "SDA4", 4) == 0) {
+            return 4;
+        } else if (std::strncmp(block + pos, "SDA5", 4) == 0) {
+            return 5;
+        } else if (std::strncmp(block + pos, "SDA8", 4) == 0) {
+            return 8;
+        }
+        pos += chunk_size;
+    }
+    return 0;
+}
+
+
+
 /**
  * Double Array Trie (read-only).
  *
@@ -734,12 +1290,457 @@ public:
         }
     };
 
+    /**
+     * A cursor class for looking up a batch of sorted keys.
+     *
+     *  This cursor remembers the path of double-array nodes visited for the
+     *  previous key, and resumes the descent for a next key from the node
+     *  at the longest common prefix of the two keys. Although keys can be
+     *  given in any order, the cursor saves most of descents when keys are
+     *  sorted in dictionary order (e.g., a merge join of sorted logs).
+     */
+    class sorted_cursor
+    {
+        friend class trie;
+
+    protected:
+        trie* m_trie;
+        /// The previous key.
+        std::string m_prev;
+        /// The node indices visited after reading i bytes of m_prev.
+        std::vector<size_type> m_path;
+
+    public:
+        /**
+         * Constructs a cursor.
+         */
+        sorted_cursor()
+            : m_trie(NULL)
+        {
+            m_path.push_back(INITIAL_INDEX);
+        }
+
+        /**
+         * Constructs a cursor from a trie.
+         *  @param  t       The pointer to a trie instance.
+         */
+        sorted_cursor(trie* t)
+            : m_trie(t)
+        {
+            m_path.push_back(INITIAL_INDEX);
+        }
+
+        /**
+         * Tests if the trie contains a key.
+         *  @param  key         The key string.
+         *  @return bool        \c true if the trie contains the key;
+         *                      \c false otherwise.
+         */
+        bool in(const char *key)
+        {
+            return (m_trie != NULL && m_trie->locate(*this, key) != 0);
+        }
+
+        /**
+         * Finds a record.
+         *  @param  key         The key string.
+         *  @param[out] value   The reference to a variable that receives the
+         *                      value of the key.
+         *  @return bool        \c true if the trie contains the key;
+         *                      \c false otherwise.
+         */
+        bool find(const char *key, value_type& value)
+        {
+            if (m_trie == NULL) {
+                return false;
+            }
+            size_type offset = m_trie->locate(*this, key);
+            if (offset != 0) {
+                m_trie->read_value(offset, value);
+                return true;
+            } else {
+                return false;
+            }
+        }
+
+        /**
+         * Forgets the previous key.
+         */
+        void reset()
+        {
+            m_prev.clear();
+            m_path.resize(1);
+        }
+    };
+
+    /**
+     * A streaming tokenizer based on the longest match (maximal munch).
+     *
+     *  This class receives a byte stream in chunks of arbitrary sizes, and
+     *  reports a token (offset, length, value) for the longest key string
+     *  that starts at the current position of the stream. A match may
+     *  straddle chunk boundaries; the tokenizer keeps the bytes of a
+     *  pending match in an internal buffer that never grows beyond the
+     *  length of the longest key, so that tokenizing a stream does not
+     *  allocate memory once the buffer is warmed up.
+     */
+    class tokenizer
+    {
+    public:
+        /**
+         * Policies for bytes that do not start any key string.
+         */
+        enum {
+            /// Skips unmatched bytes silently.
+            UNMATCHED_SKIP,
+            /// Reports each unmatched byte as a token of length one.
+            UNMATCHED_BYTE,
+            /// Reports a run of unmatched bytes as a single token.
+            UNMATCHED_RUN,
+        };
+
+        /**
+         * The type of a callback function receiving tokens.
+         *  @param  instance    The pointer to a user-defined instance.
+         *  @param  offset      The offset, in bytes, of the token from the
+         *                      beginning of the stream.
+         *  @param  length      The length, in bytes, of the token.
+         *  @param  value       The value of the token; the default value
+         *                      for unmatched tokens.
+         *  @param  matched     \c true if the token is a key in the trie;
+         *                      \c false for unmatched bytes.
+         */
+        typedef void (*callback_type)(
+            void *instance,
+            size_type offset,
+            size_type length,
+            const value_type& value,
+            bool matched
+            );
+
+    protected:
+        trie* m_trie;
+        void* m_instance;
+        callback_type m_callback;
+        int m_unmatched;
+        value_type m_default;
+
+        /// The bytes of the pending match received in previous chunks.
+        std::string m_carry;
+        /// The offset of the pending match from the beginning of the stream.
+        size_type m_offset;
+        /// The beginning and length of the run of unmatched bytes.
+        size_type m_run_offset;
+        size_type m_run_length;
+
+        /// The current node in the double array.
+        size_type m_cur;
+        /// The current position in the TAIL (zero when walking the double array).
+        size_type m_toff;
+        /// The number of bytes of the key postfix remaining from m_toff.
+        size_type m_tleft;
+        /// The offset of the value of the record whose postfix is compared.
+        size_type m_tvalue;
+        /// The number of bytes consumed for the pending match.
+        size_type m_length;
+        /// The length of the longest key found for the pending match.
+        size_type m_best_length;
+        /// The offset of the value of the longest key in the TAIL.
+        size_type m_best_value;
+
+        // The view of the current chunk.
+        const uint8_t* m_chunk;
+        size_type m_chunk_size;
+        size_type m_chunk_begin;
+
+    public:
+        /**
+         * Constructs a tokenizer.
+         *  @param  t           The pointer to a trie instance.
+         *  @param  instance    The pointer to a user-defined instance.
+         *  @param  callback    The callback function receiving tokens.
+         *  @param  unmatched   The policy for unmatched bytes.
+         *  @param  def         The value reported for unmatched tokens.
+         */
+        tokenizer(
+            trie* t,
+            void* instance,
+            callback_type callback,
+            int unmatched = UNMATCHED_BYTE,
+            const value_type& def = value_type()
+            )
+            : m_trie(t), m_instance(instance), m_callback(callback),
+            m_unmatched(unmatched), m_default(def)
+        {
+            m_carry.reserve(NUMCHARS);
+            reset();
+        }
+
+        /**
+         * Resets the tokenizer to the beginning of a new stream.
+         */
+        void reset()
+        {
+            m_carry.clear();
+            m_offset = 0;
+            m_run_offset = 0;
+            m_run_length = 0;
+            m_chunk = NULL;
+            m_chunk_size = 0;
+            m_chunk_begin = 0;
+            restart();
+        }
+
+        /**
+         * Puts a chunk of the stream.
+         *  @param  data        The pointer to the chunk.
+         *  @param  size        The size, in bytes, of the chunk.
+         */
+        void feed(const char *data, size_type size)
+        {
+            m_chunk = reinterpret_cast<const uint8_t*>(data);
+            m_chunk_size = size;
+            m_chunk_begin = 0;
+            scan(false);
+
+            // Keep the bytes of the pending match for the next chunk.
+            if (m_carry.empty()) {
+                m_carry.assign(
+                    reinterpret_cast<const char*>(m_chunk + m_chunk_begin),
+                    m_chunk_size - m_chunk_begin);
+            } else {
+                m_carry.append(
+                    reinterpret_cast<const char*>(m_chunk),
+                    m_chunk_size);
+            }
+            m_chunk = NULL;
+            m_chunk_size = 0;
+            m_chunk_begin = 0;
+        }
+
+        /**
+         * Notifies the end of the stream and reports the remaining tokens.
+         */
+        void finish()
+        {
+            scan(true);
+            flush_run();
+            reset();
+        }
+
+    protected:
+        inline size_type available() const
+        {
+            return m_carry.size() + (m_chunk_size - m_chunk_begin);
+        }
+
+        inline uint8_t at(size_type i) const
+        {
+            if (i < m_carry.size()) {
+                return (uint8_t)m_carry[i];
+            } else {
+                return m_chunk[m_chunk_begin + i - m_carry.size()];
+            }
+        }
+
+        inline void restart()
+        {
+            m_cur = INITIAL_INDEX;
+            m_toff = 0;
+            m_tleft = 0;
+            m_tvalue = 0;
+            m_length = 0;
+            m_best_length = 0;
+            m_best_value = 0;
+
+            // A trie storing a single record consists of a leaf node.
+            base_type base = m_trie->get_base(INITIAL_INDEX);
+            if (base < 0) {
+                m_tvalue = m_trie->get_postfix((size_type)-base, m_toff, m_tleft);
+            }
+        }
+
+        void advance(size_type n)
+        {
+            // Drop the first n bytes of the pending match.
+            size_type carry = m_carry.size();
+            if (n <= carry) {
+                m_carry.erase(0, n);
+            } else {
+                m_carry.clear();
+                m_chunk_begin += n - carry;
+            }
+            m_offset += n;
+        }
+
+        void scan(bool last)
+        {
+            for (;;) {
+                // Extend the pending match as long as possible.
+                bool complete = false;
+                while (m_length < available()) {
+                    if (!step(at(m_length), complete)) {
+                        break;
+                    }
+                    if (complete) {
+                        break;
+                    }
+                }
+
+                if (m_length == available() && !complete) {
+                    if (!last || m_length == 0) {
+                        // Wait for the next chunk (or the end of stream).
+                        return;
+                    }
+                }
+
+                // Emit the longest match or an unmatched byte.
+                if (0 < m_best_length) {
+                    flush_run();
+                    value_type value;
+                    m_trie->read_value(m_best_value, value);
+                    m_callback(m_instance, m_offset, m_best_length, value, true);
+                    advance(m_best_length);
+                } else {
+                    unmatched();
+                    advance(1);
+                }
+                restart();
+            }
+        }
+
+        bool step(uint8_t c, bool& complete)
+        {
+            const itail& tail = m_trie->m_tail;
+
+            if (m_toff != 0) {
+                // Compare the byte with the key postfix in the TAIL.
+                if (m_tleft == 0 || tail.block()[m_toff] != m_trie->m_fold[c]) {
+                    return false;
+                }
+                ++m_toff;
+                --m_tleft;
+                ++m_length;
+                if (m_tleft == 0) {
+                    // The key postfix ended; no longer match exists.
+                    m_best_length = m_length;
+                    m_best_value = m_tvalue;
+                    complete = true;
+                }
+                return true;
+            }
+
+            // A null byte in the stream never matches the end of a key
+            // unless the trie stores binary keys.
+            if (c == 0 && !m_trie->binary()) {
+                return false;
+            }
+            size_type next = m_trie->descend(m_cur, c);
+            if (next == INVALID_INDEX) {
+                return false;
+            }
+            ++m_length;
+
+            base_type base = m_trie->get_base(next);
+            if (base < 0) {
+                // A leaf node: continue to compare the key postfix.
+                m_tvalue = m_trie->get_postfix((size_type)-base, m_toff, m_tleft);
+                if (m_tleft == 0) {
+                    m_best_length = m_length;
+                    m_best_value = m_tvalue;
+                    complete = true;
+                }
+                return true;
+            }
+
+            // Check whether a key ends at the node.
+            m_cur = next;
+            size_type term = m_trie->terminal(next);
+            if (term != 0) {
+                size_type pos, size;
+                m_best_length = m_length;
+                m_best_value = m_trie->get_postfix(term, pos, size);
+            }
+            return true;
+        }
+
+        void unmatched()
+        {
+            switch (m_unmatched) {
+            case UNMATCHED_BYTE:
+                m_callback(m_instance, m_offset, 1, m_default, false);
+                break;
+            case UNMATCHED_RUN:
+                if (0 < m_run_length && m_run_offset + m_run_length == m_offset) {
+                    ++m_run_length;
+                } else {
+                    flush_run();
+                    m_run_offset = m_offset;
+                    m_run_length = 1;
+                }
+                break;
+            }
+        }
+
+        void flush_run()
+        {
+            if (0 < m_run_length) {
+                m_callback(m_instance, m_run_offset, m_run_length, m_default, false);
+                m_run_length = 0;
+            }
+        }
+    };
+
+    /**
+     * The memory used by a trie.
+     *  The sizes of the components are in bytes. Every byte in the memory
+     *  blocks of the components is either owned (allocated by the instance)
+     *  or borrowed (a memory block given to assign(), e.g., a memory-mapped
+     *  file); a database read by read() is owned as a whole, including the
+     *  chunk headers.
+     */
+    struct memory_usage_type
+    {
+        /// The character-mapping and folding tables.
+        size_type table;
+        /// The double array.
+        size_type da;
+        /// The TAIL array.
+        size_type tail;
+        /// The jump tables, terminal table, and pool of string values.
+        size_type extras;
+        /// The bytes allocated by the instance (including the instance).
+        size_type owned;
+        /// The bytes in memory blocks managed by others.
+        size_type borrowed;
+        /// The number of pages of the double array, TAIL, and pool.
+        size_type pages;
+        /// The number of the pages resident in physical memory.
+        size_type resident_pages;
+        /// The size of a page in bytes.
+        size_type page_size;
+    };
+
 protected:
+    typedef array<uint32_t> jumptable_type;
+
     char* m_block;
+    size_type m_block_size;
     uint8_t m_table[NUMCHARS];
     doublearray_type m_da;
     itail m_tail;
+    itail m_pool;
+    jumptable_type m_jump1;
+    jumptable_type m_jump2;
+    jumptable_type m_term;
+    jumptable_type m_counts;
+    uint32_t m_flags;
+    uint8_t m_fold[NUMCHARS];
+    bool m_folded;
     size_type m_n;
+    /// The smallest leaf offset that encodes a value instead of a TAIL
+    /// offset, or zero if no leaf stores its value.
+    size_type m_inline;
 
 public:
     /**
@@ -748,11 +1749,15 @@ public:
     trie()
     {
         m_block = NULL;
+        m_block_size = 0;
+        m_flags = 0;
+        m_inline = 0;
 
         // Initialize the character table.
         for (int i = 0;i < NUMCHARS;++i) {
             m_table[i] = i;
         }
+        set_fold(NULL);
     }
 
     /**
@@ -790,11 +1795,24 @@ public:
      *  @return bool        \c true if the trie contains the key;
      *                      \c false otherwise.
      */
-    bool in(const char *key)
+    bool in(const char *key) const
     {
         return (locate(key) != 0);
     }
 
+    /**
+     * Tests if the trie contains a key of the given length.
+     *  @param  key         The pointer to the key, which may contain null
+     *                      characters if the trie stores binary keys.
+     *  @param  length      The length, in bytes, of the key.
+     *  @return bool        \c true if the trie contains the key;
+     *                      \c false otherwise.
+     */
+    bool in(const char *key, size_type length) const
+    {
+        return (locate(key, length) != 0);
+    }
+
     /**
      * Finds a record.
      *  @param  key         The key string.
@@ -803,12 +1821,32 @@ public:
      *  @return bool        \c true if the trie contains the key;
      *                      \c false otherwise.
      */
-    bool find(const char *key, value_type& value)
+    bool find(const char *key, value_type& value) const
     {
         size_type offset = locate(key);
         if (offset != 0) {
-            m_tail.seekg(offset);
-            m_tail >> value;
+            read_value(offset, value);
+            return true;
+        } else {
+            return false;
+        }
+    }
+
+    /**
+     * Finds a record with a key of the given length.
+     *  @param  key         The pointer to the key, which may contain null
+     *                      characters if the trie stores binary keys.
+     *  @param  length      The length, in bytes, of the key.
+     *  @param[out] value   The reference to a variable that receives the
+     *                      value of the key.
+     *  @return bool        \c true if the trie contains the key;
+     *                      \c false otherwise.
+     */
+    bool find(const char *key, size_type length, value_type& value) const
+    {
+        size_type offset = locate(key, length);
+        if (offset != 0) {
+            read_value(offset, value);
             return true;
         } else {
             return false;
@@ -822,7 +1860,7 @@ public:
      *  @return value_type  The value if the key exists in the trie,
      *                      the default value (def) otherwise.
      */
-    value_type get(const char *key, const value_type& def)
+    value_type get(const char *key, const value_type& def) const
     {
         value_type value;
         if (find(key, value)) {
@@ -843,907 +1881,3876 @@ public:
     }
 
     /**
-     * Assigns a double-array trie from a builder.
-     *  @param  da              The vector of double-array elements.
-     *  @param  tail            The tail array.
-     *  @param  table           The character-mapping table.
+     * Constructs a cursor for prefix match with a query of the given length.
+     *  @param  str             The pointer to the query.
+     *  @param  length          The length, in bytes, of the query.
+     *  @return prefix_cursor   The instance of a cursor.
      */
-    void assign(
-        const std::vector<element_type>& da,
-        const otail& tail,
-        const uint8_t* table
-        )
+    prefix_cursor prefix(const char *str, size_type length)
     {
-        m_da.assign(const_cast<element_type*>(&da[0]), da.size(), true);
-        m_tail.assign(tail.block(), tail.bytes(), true);
-        for (int i = 0;i < NUMCHARS;++i) {
-            m_table[i] = table[i];
-        }
+        return prefix_cursor(this, std::string(str, length));
     }
 
-protected:
-    size_type locate(const char *key)
+    /**
+     * Counts the keys that start with a prefix.
+     *  When the trie has a "CNTS" chunk (see builder::set_counts()), the
+     *  count is read at the node that the prefix reaches; otherwise, the
+     *  keys under the node are counted by traversing its subtree.
+     *  @param  str             The prefix.
+     *  @return size_type       The number of keys that start with the prefix.
+     */
+    size_type count_prefix(const char *str) const
     {
-        const char *p = key;
-        const char *last = key + strlen(key);
-        size_type offset = 0;
+        return count_prefix(str, std::strlen(str));
+    }
+
+    /**
+     * Counts the keys that start with a prefix of the given length.
+     *  @param  str             The pointer to the prefix.
+     *  @param  length          The length, in bytes, of the prefix.
+     *  @return size_type       The number of keys that start with the prefix.
+     */
+    size_type count_prefix(const char *str, size_type length) const
+    {
+        // A key of a text trie never contains a null character.
+        if (!(m_flags & FLAG_BINARY) && std::memchr(str, 0, length) != NULL) {
+            return 0;
+        }
+
+        const char *p = str;
+        const char *last = str + length;
         size_type cur = INITIAL_INDEX;
-        const uint8_t* table = m_table;
 
         for (;;) {
             base_type base = get_base(cur);
-            if (base < 0) {
-                // The element #cur is a leaf node.
-                offset = (size_type)-base;
-                break;
+            if (base == 0) {
+                // An unused element, whose CHECK may match the code 0.
+                return 0;
+            } else if (base < 0) {
+                // The rest of the prefix must be a prefix of the key postfix.
+                size_type pos, size;
+                get_postfix((size_type)-base, pos, size);
+                size_type rest = (size_type)(last - p);
+                return (rest <= size && match_bytes(pos, p, rest)) ? 1 : 0;
             }
 
-            // If the pointer exceeded the end of string.
-            if (last < p) {
-                // The key string couldn't reach a leaf node.
-                return false;
+            if (p == last) {
+                break;
             }
 
             // Try to descend to the child node.
             cur = descend(cur, *reinterpret_cast<const uint8_t*>(p));
             if (cur == INVALID_INDEX) {
-                return false;
+                return 0;
             }
 
             ++p;
         }
 
-        // 
-        if (last < p) {
-            p = last;
-        }
+        return count_subtree(cur);
+    }
 
-        // Seek to the position of the key postfix in the TAIL.
-        m_tail.seekg(offset);
+    /**
+     * Checks whether the trie stores binary keys.
+     *  @return bool        \c true if keys are delimited by length and may
+     *                      contain null characters; \c false if keys are
+     *                      null-terminated strings.
+     */
+    bool binary() const
+    {
+        return ((m_flags & FLAG_BINARY) != 0);
+    }
 
-        // Check if two key postfixes are identical.
-        if (m_tail.match_string(p)) {
-            return offset + m_tail.strlen() + 1;
+    /**
+     * Checks whether the trie folds the bytes of queries.
+     *  @return bool        \c true if the trie was built with a folding map
+     *                      (e.g., case folding), and queries match the keys
+     *                      that they fold into; \c false otherwise.
+     */
+    bool folded() const
+    {
+        return m_folded;
+    }
+
+    /**
+     * Constructs a cursor for looking up sorted keys.
+     *  @return sorted_cursor   The instance of a cursor.
+     */
+    sorted_cursor sorted()
+    {
+        return sorted_cursor(this);
+    }
+
+    /**
+     * Faults in every page of the trie.
+     *  This function advises the operating system to read ahead the memory
+     *  of the double array and tail (madvise(MADV_WILLNEED)), and reads a
+     *  byte from every page so that lookups right after loading (e.g., a
+     *  memory-mapped file) do not wait for page faults.
+     *  @param  num_threads     The number of threads touching pages; this
+     *                          is effective only when compiled as C++11.
+     *  @return size_type       The number of pages touched.
+     */
+    size_type warmup(int num_threads = 1) const
+    {
+        regions_type regions;
+        get_regions(regions);
+
+        size_type n = 0;
+        for (size_t i = 0;i < regions.size();++i) {
+            advise_willneed(regions[i].first, regions[i].second);
+            n += num_pages(regions[i].first, regions[i].second);
+        }
+
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && 1900 <= _MSC_VER)
+        if (1 < num_threads) {
+            std::vector<std::thread> threads;
+            for (int t = 0;t < num_threads;++t) {
+                threads.push_back(std::thread(
+                    &trie::touch_regions, this, t, num_threads));
+            }
+            for (size_t t = 0;t < threads.size();++t) {
+                threads[t].join();
+            }
+            return n;
+        }
+#endif
+        touch_regions(0, 1);
+        return n;
+    }
+
+    /**
+     * Touches the nodes in the top levels of the trie.
+     *  This function visits nodes in breadth-first order from the root,
+     *  loading the double-array elements (and the TAIL of leaves) that
+     *  every lookup reads first.
+     *  @param  depth           The number of levels to be visited.
+     *  @return size_type       The number of nodes visited.
+     */
+    size_type warmup_levels(int depth) const
+    {
+        volatile uint8_t sink = 0;
+        size_type n = 0;
+        std::vector<size_type> level, next;
+
+        level.push_back(INITIAL_INDEX);
+        for (int d = 0;d <= depth && !level.empty();++d) {
+            next.clear();
+            for (size_t i = 0;i < level.size();++i) {
+                ++n;
+                base_type base = get_base(level[i]);
+                if (base < 0) {
+                    if (!is_inline((size_type)-base)) {
+                        sink = sink + m_tail.block()[(size_type)-base];
+                    }
+                    continue;
+                }
+                if (d == depth) {
+                    continue;
+                }
+                // Unused elements have zero BASE values.
+                for (int c = 0;c < NUMCHARS;++c) {
+                    size_type child = (size_type)base + (size_type)c + 1;
+                    if (child < m_da.size() && get_check(child) == (check_type)c &&
+                        get_base(child) != 0) {
+                        next.push_back(child);
+                    }
+                }
+            }
+            level.swap(next);
+        }
+        return n;
+    }
+
+    /**
+     * Touches the pages listed in an access profile.
+     *  @param  is              The input stream of a profile written by
+     *                          save_profile().
+     *  @return size_type       The number of pages touched.
+     */
+    size_type warmup_profile(std::istream& is) const
+    {
+        volatile uint8_t sink = 0;
+        size_type n = 0;
+        regions_type regions;
+        get_regions(regions);
+        const size_type page = page_size();
+
+        for (;;) {
+            uint32_t entry[2];
+            is.read(reinterpret_cast<char*>(entry), sizeof(entry));
+            if (is.fail()) {
+                break;
+            }
+            if (entry[0] < regions.size()) {
+                // Page numbers count from the page including the region.
+                const region_type& r = regions[entry[0]];
+                const char* p = (const char*)
+                    (((size_t)r.first / page + entry[1]) * page);
+                if (p < r.first) {
+                    p = r.first;
+                }
+                if (p < r.first + r.second) {
+                    sink = sink + (uint8_t)*p;
+                    ++n;
+                }
+            }
+        }
+        return n;
+    }
+
+    /**
+     * Writes the list of the resident pages of the trie as a profile.
+     *  Save a profile from a process in a steady state, and replay it by
+     *  warmup_profile() after a restart. The profile is empty on platforms
+     *  other than Linux.
+     *  @param  os              The output stream.
+     *  @return size_type       The number of pages written.
+     */
+    size_type save_profile(std::ostream& os) const
+    {
+        size_type n = 0;
+        regions_type regions;
+        get_regions(regions);
+
+        for (size_t i = 0;i < regions.size();++i) {
+            std::vector<bool> resident;
+            residency(regions[i].first, regions[i].second, resident);
+            for (size_t j = 0;j < resident.size();++j) {
+                if (resident[j]) {
+                    uint32_t entry[2] = {(uint32_t)i, (uint32_t)j};
+                    os.write(reinterpret_cast<const char*>(entry), sizeof(entry));
+                    ++n;
+                }
+            }
+        }
+        return n;
+    }
+
+    /**
+     * Counts the pages of the trie resident in physical memory.
+     *  @param[out] total       The number of pages of the trie.
+     *  @return size_type       The number of resident pages; this is
+     *                          identical to total on platforms other than
+     *                          Linux.
+     */
+    size_type resident_pages(size_type& total) const
+    {
+        size_type n = 0;
+        regions_type regions;
+        get_regions(regions);
+
+        total = 0;
+        for (size_t i = 0;i < regions.size();++i) {
+            std::vector<bool> resident;
+            residency(regions[i].first, regions[i].second, resident);
+            total += resident.size();
+            n += (size_type)std::count(resident.begin(), resident.end(), true);
+        }
+        return n;
+    }
+
+    /**
+     * Reports the memory used by the trie.
+     *  The resident pages are counted by mincore() on Linux; on other
+     *  platforms, every page is reported as resident.
+     *  @return memory_usage_type   The breakdown of the memory.
+     */
+    memory_usage_type memory_usage() const
+    {
+        memory_usage_type mu;
+        mu.table = sizeof(m_table) + sizeof(m_fold);
+        mu.da = sizeof(element_type) * m_da.size();
+        mu.tail = m_tail.bytes();
+        mu.extras = sizeof(uint32_t) *
+            (m_jump1.size() + m_jump2.size() + m_term.size() + m_counts.size()) +
+            m_pool.bytes();
+
+        // Components without their own copies refer to the memory block
+        // given to assign(), or to the database read by read().
+        mu.owned = sizeof(*this) + m_block_size;
+        mu.borrowed = 0;
+        if (m_da.own()) {
+            mu.owned += mu.da;
         } else {
-            return 0;
+            mu.borrowed += mu.da;
+        }
+        if (m_tail.own()) {
+            mu.owned += mu.tail;
+        } else {
+            mu.borrowed += mu.tail;
+        }
+        if (m_pool.own()) {
+            mu.owned += m_pool.bytes();
+        } else {
+            mu.borrowed += m_pool.bytes();
+        }
+        const jumptable_type* tables[] = {&m_jump1, &m_jump2, &m_term, &m_counts};
+        for (size_type i = 0;i < sizeof(tables) / sizeof(tables[0]);++i) {
+            if (tables[i]->own()) {
+                mu.owned += sizeof(uint32_t) * tables[i]->size();
+            } else {
+                mu.borrowed += sizeof(uint32_t) * tables[i]->size();
+            }
         }
+        if (m_block != NULL) {
+            // The database read by read() is owned as a whole.
+            mu.borrowed = 0;
+        }
+
+        mu.resident_pages = resident_pages(mu.pages);
+        mu.page_size = page_size();
+        return mu;
     }
 
-    size_type descend(size_type i, const uint8_t c) const
+    /**
+     * Assigns a double-array trie from a builder.
+     *  @param  da              The vector of double-array elements.
+     *  @param  tail            The tail array.
+     *  @param  table           The character-mapping table.
+     *  @param  pool            The pointer to the pool of string values, or
+     *                          \c NULL if the builder uses no pool.
+     *  @param  fold            The folding map, or \c NULL if the builder
+     *                          uses no folding map.
+     */
+    void assign(
+        const std::vector<element_type>& da,
+        const otail& tail,
+        const uint8_t* table,
+        const otail* pool = NULL,
+        const uint8_t* fold = NULL
+        )
     {
-        const uint8_t* table = m_table;
+        m_da.assign(const_cast<element_type*>(&da[0]), da.size(), true);
+        assign_tail(tail, table, pool, fold);
+    }
 
-        base_type base = get_base(i);
-        if (base <= 0) {
-            // The element #i is not a node.
-            return INVALID_INDEX;
+    /**
+     * Assigns a double-array trie from a builder.
+     *  @param  da              The double array of the builder.
+     *  @param  tail            The tail array.
+     *  @param  table           The character-mapping table.
+     *  @param  pool            The pointer to the pool of string values, or
+     *                          \c NULL if the builder uses no pool.
+     *  @param  fold            The folding map, or \c NULL if the builder
+     *                          uses no folding map.
+     */
+    template <int segment_bits>
+    void assign(
+        const segmented_array<element_type, segment_bits>& da,
+        const otail& tail,
+        const uint8_t* table,
+        const otail* pool = NULL,
+        const uint8_t* fold = NULL
+        )
+    {
+        m_da.allocate(da.size());
+        da.copy(&m_da[0]);
+        assign_tail(tail, table, pool, fold);
+    }
+
+    /**
+     * Assigns a double-array trie from a builder with its options.
+     *  Unlike the overloads that take the arrays of the builder, this
+     *  function also carries the binary mode, the terminal nodes of
+     *  binary keys, the start of the values in leaf elements, the numbers
+     *  of keys under internal nodes, and the jump tables, so that the trie
+     *  behaves the same as the one written by the builder and read back by
+     *  read().
+     *  @param  builder         The builder that has built the trie.
+     */
+    template <class builder_type>
+    void assign(const builder_type& builder)
+    {
+        assign(
+            builder.doublearray(), builder.tail(), builder.table(),
+            &builder.pool(), builder.fold()
+            );
+        if (builder.binary()) {
+            std::vector<uint32_t> terms;
+            builder.terminals(terms);
+            m_term.assign(terms.empty() ? NULL : &terms[0], terms.size(), true);
+            m_flags |= FLAG_BINARY;
         }
-        check_type check = (check_type)table[c];
-        size_type next = base + (size_type)check + 1;
-        if (m_da.size() <= next) {
-            // Outside of the double array.
-            return INVALID_INDEX;
+        m_inline = builder.inline_base();
+
+        std::vector<uint32_t> counts, jump1, jump2;
+        builder.counts(counts);
+        if (!counts.empty()) {
+            m_counts.assign(&counts[0], counts.size(), true);
         }
-        if (get_check(next) != check) {
-            // The backward link does not exist.
-            return INVALID_INDEX;
+        builder.jump_tables(jump1, jump2);
+        if (!jump1.empty()) {
+            m_jump1.assign(&jump1[0], jump1.size(), true);
         }
+        if (!jump2.empty()) {
+            m_jump2.assign(&jump2[0], jump2.size(), true);
+        }
+    }
 
-        return next;
+protected:
+    void set_fold(const uint8_t* fold)
+    {
+        m_folded = (fold != NULL);
+        for (int i = 0;i < NUMCHARS;++i) {
+            m_fold[i] = m_folded ? fold[i] : (uint8_t)i;
+        }
+    }
+
+    /*
+     * Compares the bytes of a query with a key postfix in the TAIL, folding
+     * the bytes of the query if the trie has a folding map.
+     */
+    inline bool match_bytes(size_type pos, const char *p, size_type size) const
+    {
+        const uint8_t* block = m_tail.block() + pos;
+        if (!m_folded) {
+            return (std::memcmp(block, p, size) == 0);
+        }
+        for (size_type i = 0;i < size;++i) {
+            if (block[i] != m_fold[(uint8_t)p[i]]) {
+                return false;
+            }
+        }
+        return true;
     }
 
-    bool next_prefix(prefix_cursor& pfx)
+    void assign_tail(const otail& tail, const uint8_t* table, const otail* pool, const uint8_t* fold)
     {
-        const char *p = pfx.query.c_str();
-        size_type offset = 0;
-        const uint8_t* table = m_table;
+        m_tail.assign(tail.block(), tail.bytes(), true);
+        for (int i = 0;i < NUMCHARS;++i) {
+            m_table[i] = table[i];
+        }
+        m_jump1.free();
+        m_jump2.free();
+        m_term.free();
+        m_counts.free();
+        m_flags = 0;
+        m_inline = 0;
+        set_fold(fold);
+        if (pool != NULL && 0 < pool->bytes()) {
+            m_pool.assign(pool->block(), pool->bytes(), true);
+        } else {
+            m_pool.assign(NULL, 0);
+        }
+    }
 
-        if (std::strlen(p) <= pfx.length) {
-            return false;
+    size_type locate(const char *key) const
+    {
+        if (m_flags & FLAG_BINARY) {
+            return locate(key, std::strlen(key));
         }
 
-        if (get_base(pfx.cur) < 0) {
-            // We have already reached a leaf node.
-            return false;
+        const char *p = key;
+        const char *last = key + strlen(key);
+        size_type offset = 0;
+        size_type cur = INITIAL_INDEX;
+        const uint8_t* table = m_table;
+
+        // Skip the descents for the first bytes by the jump tables.
+        if (*p != 0 && m_jump2) {
+            uint32_t entry = m_jump2[((size_type)(uint8_t)p[0] << 8) | (uint8_t)p[1]];
+            if (entry == 0) {
+                return 0;
+            }
+            cur = (size_type)(entry >> 1);
+            p += 1 + (entry & 1);
+        } else if (m_jump1) {
+            cur = (size_type)m_jump1[(uint8_t)*p++];
+            if (cur == INVALID_INDEX) {
+                return 0;
+            }
         }
 
         for (;;) {
-            base_type base = get_base(pfx.cur);
+            base_type base = get_base(cur);
             if (base < 0) {
-                // The element #(pfx.cur) is a leaf node.
+                // The element #cur is a leaf node.
                 offset = (size_type)-base;
                 break;
             }
 
-            if (pfx.query.length() < pfx.length) {
+            // If the pointer exceeded the end of string.
+            if (last < p) {
                 // The key string couldn't reach a leaf node.
                 return false;
             }
 
             // Try to descend to the child node.
-            pfx.cur = descend(pfx.cur, (uint8_t)p[pfx.length]);
-            if (pfx.cur == INVALID_INDEX) {
+            cur = descend(cur, *reinterpret_cast<const uint8_t*>(p));
+            if (cur == INVALID_INDEX) {
                 return false;
             }
 
-            // Try to descend to the child node with '\0'.
-            size_type cur = descend(pfx.cur, 0);
-            if (cur != INVALID_INDEX) {
-                base = get_base(cur);
-                if (base != 0) {
-                    if (0 <= base) {
-                        throw exception("An invalid arc found after a null character");
-                    }
-                    m_tail.seekg((size_type)-base);
-                    if (m_tail.strlen() != 0) {
-                        throw exception("A non empty tail found after a null character");
-                    }
-                    ++pfx.length;
-                    m_tail.seekg(((size_type)-base) + 1);
-                    m_tail >> pfx.value;
-                    return true;
-                }
-            }
-
-            ++pfx.length;
-        }
-
-        if (pfx.query.length() < pfx.length) {
-            pfx.length = pfx.query.length();
+            ++p;
         }
 
-        // Seek to the position of the key postfix in the TAIL.
-        m_tail.seekg(offset);
-
-        // Check if two key postfixes are identical.
-        bool match = m_tail.match_string_partial(&p[pfx.length]);
-        if (match) {
-            size_type postfix_size = m_tail.strlen();
-            pfx.length += postfix_size;
-            // Skip the key postfix.
-            m_tail.seekg(offset + postfix_size + 1);
-            // Read the value.
-            m_tail >> pfx.value;
+        // 
+        if (last < p) {
+            p = last;
         }
-        
-        return match;
-    }
-
-    inline base_type get_base(size_type i) const
-    {
-        return doublearray_traits::get_base(m_da[i]);
-    }
 
-    inline check_type get_check(size_type i) const
-    {
-        return doublearray_traits::get_check(m_da[i]);
+        return match_leaf(cur, offset, p);
     }
 
-public:
-    /**
-     * Assigns a double-array trie from a memory image.
-     *  @param  block           The pointer to the memory block.
-     *  @param  size            The size, in bytes, of the memory block.
-     *  @return size_type       If successful, the size, in bytes, of the
-     *                          memory block used to read a double-array trie;
-     *                          otherwise zero.
-     */
-    size_type assign(const char *block, size_type size)
+    size_type locate(sorted_cursor& sc, const char *key) const
     {
-        char chunk[4];
-        uint32_t value, sdat_size, total_size;
-        const uint8_t* p = reinterpret_cast<const uint8_t*>(block);
+        size_type length = std::strlen(key);
+        std::vector<size_type>& path = sc.m_path;
 
-        // The size of the memory block must not be smaller than SDAT_CHUNKSIZE.
-        if (size < SDAT_CHUNKSIZE) {
-            return 0;
+        // The path is recorded for null-terminated keys only.
+        if (m_flags & FLAG_BINARY) {
+            return locate(key, length);
         }
 
-        // Read the "SDAT" chunk.
-        p += read_chunk(p, chunk, total_size);
-        if (std::strncmp(chunk, "SDAT", 4) != 0) {
-            return 0;
+        // Find the longest common prefix of the previous key and this key
+        // within the range of the path recorded for the previous key.
+        size_type lcp = 0;
+        size_type max = std::min(sc.m_prev.length(), length);
+        if (path.size() - 1 < max) {
+            max = path.size() - 1;
         }
-
-        // Check the size of the "SDAT" chunk.
-        p += read_uint32(p, sdat_size);
-        if (sdat_size != SDAT_CHUNKSIZE) {
-            return 0;
+        const char *prev = sc.m_prev.c_str();
+        while (lcp < max && prev[lcp] == key[lcp]) {
+            ++lcp;
         }
 
-        // Read the number of records in the trie.
-        p += read_uint32(p, value);
-        m_n = (size_type)value;
+        // Forget the nodes below the common prefix.
+        path.resize(lcp + 1);
+        sc.m_prev.assign(key, length);
 
-        // Loop for child chunks.
-        const uint8_t* last = reinterpret_cast<const uint8_t*>(block) + total_size;
-        while (p < last) {
-            uint32_t size;
-            const uint8_t* q = p;
-            q += read_chunk(q, chunk, size);
-            uint32_t datasize = size - CHUNKSIZE;
+        const char *p = key + lcp;
+        const char *last = key + length;
+        size_type offset = 0;
+        size_type cur = path[lcp];
 
-            if (strncmp(chunk, "TBLU", 4) == 0) {
-                // "TBLU" chunk.
-                if (datasize == NUMCHARS) {
-                    for (int i = 0;i < NUMCHARS;++i) {
-                        m_table[i] = q[i];
-                    }
-                }
+        // Resume the descent from the node at the common prefix.
+        for (;;) {
+            base_type base = get_base(cur);
+            if (base < 0) {
+                // The element #cur is a leaf node.
+                offset = (size_type)-base;
+                break;
+            }
+
+            // If the pointer exceeded the end of string.
+            if (last < p) {
+                // The key string couldn't reach a leaf node.
+                return 0;
+            }
+
+            // Try to descend to the child node.
+            cur = descend(cur, *reinterpret_cast<const uint8_t*>(p));
+            if (cur == INVALID_INDEX) {
+                return 0;
+            }
+            path.push_back(cur);
+
+            ++p;
+        }
+
+        if (last < p) {
+            p = last;
+        }
+
+        return match_leaf(cur, offset, p);
+    }
+
+    size_type locate(const char *key, size_type length) const
+    {
+        // A key of a text trie never contains a null character.
+        if (!(m_flags & FLAG_BINARY)) {
+            if (std::memchr(key, 0, length) != NULL) {
+                return 0;
+            }
+            std::string str(key, length);
+            return locate(str.c_str());
+        }
+
+        const char *p = key;
+        const char *last = key + length;
+        size_type offset = 0;
+        size_type cur = INITIAL_INDEX;
+
+        for (;;) {
+            base_type base = get_base(cur);
+            if (base < 0) {
+                // The element #cur is a leaf node.
+                offset = (size_type)-base;
+                break;
+            }
+
+            if (p == last) {
+                // The key ends at the node #cur.
+                offset = terminal(cur);
+                if (offset == 0) {
+                    return 0;
+                }
+                break;
+            }
+
+            // Try to descend to the child node.
+            cur = descend(cur, *reinterpret_cast<const uint8_t*>(p));
+            if (cur == INVALID_INDEX) {
+                return 0;
+            }
+
+            ++p;
+        }
+
+        // Check if two key postfixes are identical.
+        size_type pos, size;
+        size_type value = get_postfix(offset, pos, size);
+        if (size == (size_type)(last - p) && match_bytes(pos, p, size)) {
+            return value;
+        } else {
+            return 0;
+        }
+    }
+
+    /*
+     * Obtains the key postfix of a record in the TAIL. A postfix is a null-
+     * terminated string, or a byte string preceded by its length (encoded
+     * in 7 bits per byte, lower bits first) when the trie is binary.
+     *  @param  offset      The offset of the record.
+     *  @param[out] pos     The offset of the postfix.
+     *  @param[out] size    The length of the postfix.
+     *  @return size_type   The offset of the value of the record.
+     */
+    inline size_type get_postfix(size_type offset, size_type& pos, size_type& size) const
+    {
+        if (is_inline(offset)) {
+            // The postfix is empty and the value is in the leaf element.
+            pos = offset;
+            size = 0;
+            return offset;
+        }
+
+        const uint8_t* block = m_tail.block();
+        if (m_flags & FLAG_BINARY) {
+            size = 0;
+            for (int shift = 0;;shift += 7) {
+                uint8_t c = block[offset++];
+                size |= (size_type)(c & 0x7F) << shift;
+                if (!(c & 0x80)) {
+                    break;
+                }
+            }
+            pos = offset;
+            return pos + size;
+        } else {
+            pos = offset;
+            size = std::strlen(reinterpret_cast<const char*>(block + offset));
+            return pos + size + 1;
+        }
+    }
+
+    /*
+     * Finds the record of the key that ends at an internal node.
+     *  @param  cur         The index of the node.
+     *  @return size_type   The offset of the record in the TAIL, or zero if
+     *                      no key ends at the node.
+     */
+    size_type terminal(size_type cur) const
+    {
+        if (m_flags & FLAG_BINARY) {
+            // "TERM" lists pairs of (node, offset) sorted by node indices.
+            size_type lo = 0, hi = m_term.size() / 2;
+            while (lo < hi) {
+                size_type mid = (lo + hi) / 2;
+                if (m_term[2*mid] < cur) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            if (lo < m_term.size() / 2 && m_term[2*lo] == cur) {
+                return (size_type)m_term[2*lo+1];
+            }
+            return 0;
+        }
+
+        // A key ends at the node if the node has a leaf for '\0'.
+        size_type term = descend(cur, 0);
+        if (term != INVALID_INDEX) {
+            base_type base = get_base(term);
+            if (base < 0) {
+                return (size_type)-base;
+            }
+        }
+        return 0;
+    }
+
+    /*
+     * Counts the keys under the internal node #cur.
+     */
+    size_type count_subtree(size_type cur) const
+    {
+        if (cur < m_counts.size()) {
+            return (size_type)m_counts[cur];
+        }
+
+        // Count the leaves and the terminal nodes in the subtree.
+        size_type n = 0;
+        std::vector<size_type> stack(1, cur);
+        while (!stack.empty()) {
+            size_type i = stack.back();
+            stack.pop_back();
+
+            base_type base = get_base(i);
+            if (base < 0) {
+                ++n;
+                continue;
+            }
+            if ((m_flags & FLAG_BINARY) && terminal(i) != 0) {
+                ++n;
+            }
+
+            // Unused elements have zero BASE values.
+            for (int c = 0;c < NUMCHARS;++c) {
+                size_type next = (size_type)base + c + 1;
+                if (m_da.size() <= next) {
+                    break;
+                }
+                if (get_check(next) == (check_type)c && get_base(next) != 0) {
+                    stack.push_back(next);
+                }
+            }
+        }
+        return n;
+    }
+
+    /*
+     * Compares a query with the key postfix of the leaf #cur, using the
+     * bytes of the postfix stored in the element (if any) before the TAIL.
+     */
+    inline size_type match_leaf(size_type cur, size_type offset, const char *p) const
+    {
+        if (is_inline(offset)) {
+            // The key ends at the leaf, which stores the value.
+            return (m_fold[(uint8_t)*p] == 0) ? offset : 0;
+        }
+
+        const int n = doublearray_traits::inline_size();
+        if (0 < n) {
+            const uint8_t* inl = doublearray_traits::get_inline(m_da[cur]);
+            for (int i = 0;i < n;++i) {
+                uint8_t c = m_fold[(uint8_t)p[i]];
+                if (inl[i] != c) {
+                    return 0;
+                } else if (c == 0) {
+                    // The postfix ends in the element.
+                    return offset + i + 1;
+                }
+            }
+            return match_tail(offset + n, p + n);
+        }
+        return match_tail(offset, p);
+    }
+
+    size_type match_tail(size_type offset, const char *p) const
+    {
+        // Seek to the position of the key postfix in the TAIL.
+        itail tail;
+        tail_reader(tail, offset);
+
+        // Check if two key postfixes are identical.
+        if (tail.match_string(p, m_folded ? m_fold : NULL)) {
+            return offset + tail.strlen() + 1;
+        } else {
+            return 0;
+        }
+    }
+
+    /*
+     * Lookups never move the read position of m_tail, but read the TAIL
+     * through a local reader so that threads can share a trie instance.
+     */
+    inline void tail_reader(itail& tail, size_type offset) const
+    {
+        tail.assign(m_tail.block(), m_tail.bytes());
+        tail.seekg(offset);
+    }
+
+    /*
+     * Tests whether an offset obtained from a leaf (or returned by locate())
+     * encodes a value stored in the leaf element rather than a TAIL offset;
+     * this is constantly false for a value type that cannot be stored.
+     */
+    inline bool is_inline(size_type offset) const
+    {
+        return (
+            inline_value_traits<value_type>::available &&
+            m_inline != 0 && m_inline <= offset
+            );
+    }
+
+    inline void read_value(size_type offset, value_type& value) const
+    {
+        if (is_inline(offset)) {
+            inline_value_traits<value_type>::decode(
+                (uint32_t)(offset - m_inline), value);
+            return;
+        }
+
+        itail tail;
+        tail_reader(tail, offset);
+        get_value(tail, value);
+    }
+
+    template <class type>
+    inline void get_value(itail& tail, type& value) const
+    {
+        tail >> value;
+    }
+
+    /*
+     * When the trie has a "POOL" chunk, the TAIL stores the offset of a
+     * string value in the pool instead of the string itself.
+     */
+    inline void get_value(itail& tail, char*& value) const
+    {
+        if (m_pool) {
+            itail pool;
+            pool_reader(tail, pool);
+            pool >> value;
+        } else {
+            tail >> value;
+        }
+    }
+
+    inline void get_value(itail& tail, std::string& value) const
+    {
+        if (m_pool) {
+            itail pool;
+            pool_reader(tail, pool);
+            pool >> value;
+        } else {
+            tail >> value;
+        }
+    }
+
+    inline void pool_reader(itail& tail, itail& pool) const
+    {
+        // The offset is encoded in 7 bits per byte, lower bits first.
+        size_type ref = 0;
+        for (int shift = 0;shift < 35;shift += 7) {
+            uint8_t c = 0;
+            tail.read(c);
+            ref |= (size_type)(c & 0x7F) << shift;
+            if (!(c & 0x80)) {
+                break;
+            }
+        }
+        pool.assign(m_pool.block(), m_pool.bytes());
+        pool.seekg(ref);
+    }
+
+    /// A memory region (pointer and size in bytes) of the trie.
+    typedef std::pair<const char*, size_type> region_type;
+    typedef std::vector<region_type> regions_type;
+
+    /*
+     * The regions are listed in the order of accesses by a lookup: the
+     * double array first, then the TAIL and the pool of string values.
+     */
+    void get_regions(regions_type& regions) const
+    {
+        regions.clear();
+        if (0 < m_da.size()) {
+            regions.push_back(region_type(
+                reinterpret_cast<const char*>(&m_da[0]),
+                sizeof(element_type) * m_da.size()));
+        }
+        if (0 < m_tail.bytes()) {
+            regions.push_back(region_type(
+                reinterpret_cast<const char*>(m_tail.block()),
+                m_tail.bytes()));
+        }
+        if (m_pool) {
+            regions.push_back(region_type(
+                reinterpret_cast<const char*>(m_pool.block()),
+                m_pool.bytes()));
+        }
+    }
+
+    static size_type page_size()
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        long size = sysconf(_SC_PAGESIZE);
+        return (0 < size) ? (size_type)size : 4096;
+#else
+        return 4096;
+#endif
+    }
+
+    static size_type num_pages(const char* block, size_type size)
+    {
+        const size_type page = page_size();
+        size_t begin = (size_t)block / page;
+        size_t end = ((size_t)block + size + page - 1) / page;
+        return (size_type)(end - begin);
+    }
+
+    static void advise_willneed(const char* block, size_type size)
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        // madvise() requires a page-aligned address.
+        const size_type page = page_size();
+        char* begin = (char*)((size_t)block / page * page);
+        size_t length = (size_t)(block + size - begin);
+        madvise(begin, length, MADV_WILLNEED);
+#endif
+    }
+
+    static void residency(
+        const char* block, size_type size, std::vector<bool>& resident)
+    {
+        const size_type page = page_size();
+        const char* begin = (const char*)((size_t)block / page * page);
+        resident.assign(num_pages(block, size), true);
+#if defined(__linux__)
+        std::vector<unsigned char> vec(resident.size());
+        if (mincore((void*)begin, (size_t)(block + size - begin), &vec[0]) == 0) {
+            for (size_t i = 0;i < vec.size();++i) {
+                resident[i] = ((vec[i] & 1) != 0);
+            }
+        }
+#endif
+    }
+
+    /*
+     * Reads one byte from every page such that page #i is touched by the
+     * thread #(i % num_threads).
+     */
+    void touch_regions(int thread, int num_threads) const
+    {
+        volatile uint8_t sink = 0;
+        const size_type page = page_size();
+        regions_type regions;
+        get_regions(regions);
+
+        size_type i = 0;
+        for (size_t r = 0;r < regions.size();++r) {
+            const char* block = regions[r].first;
+            const char* last = block + regions[r].second;
+            // The first byte of each page, but the first page starts
+            // at the beginning of the region.
+            const char* p = block;
+            while (p < last) {
+                if ((int)(i++ % num_threads) == thread) {
+                    sink = sink + (uint8_t)*p;
+                }
+                p = (const char*)(((size_t)p / page + 1) * page);
+            }
+        }
+    }
+
+    size_type descend(size_type i, const uint8_t c) const
+    {
+        const uint8_t* table = m_table;
+
+        base_type base = get_base(i);
+        if (base <= 0) {
+            // The element #i is not a node.
+            return INVALID_INDEX;
+        }
+        check_type check = (check_type)table[c];
+        size_type next = base + (size_type)check + 1;
+        if (m_da.size() <= next) {
+            // Outside of the double array.
+            return INVALID_INDEX;
+        }
+        if (get_check(next) != check) {
+            // The backward link does not exist.
+            return INVALID_INDEX;
+        }
+
+        return next;
+    }
+
+    bool next_prefix(prefix_cursor& pfx) const
+    {
+        if (m_flags & FLAG_BINARY) {
+            return next_prefix_binary(pfx);
+        }
+
+        const char *p = pfx.query.c_str();
+        size_type offset = 0;
+        const uint8_t* table = m_table;
+
+        if (std::strlen(p) <= pfx.length) {
+            return false;
+        }
+
+        if (get_base(pfx.cur) < 0) {
+            // We have already reached a leaf node.
+            return false;
+        }
+
+        for (;;) {
+            base_type base = get_base(pfx.cur);
+            if (base < 0) {
+                // The element #(pfx.cur) is a leaf node.
+                offset = (size_type)-base;
+                break;
+            }
+
+            if (pfx.query.length() < pfx.length) {
+                // The key string couldn't reach a leaf node.
+                return false;
+            }
+
+            // Try to descend to the child node; the child of the root node
+            // is found in the jump table if any.
+            if (pfx.cur == INITIAL_INDEX && m_jump1) {
+                pfx.cur = (size_type)m_jump1[(uint8_t)p[pfx.length]];
+            } else {
+                pfx.cur = descend(pfx.cur, (uint8_t)p[pfx.length]);
+            }
+            if (pfx.cur == INVALID_INDEX) {
+                return false;
+            }
+
+            // Try to descend to the child node with '\0'.
+            size_type cur = descend(pfx.cur, 0);
+            if (cur != INVALID_INDEX) {
+                base = get_base(cur);
+                if (base != 0) {
+                    if (0 <= base) {
+                        throw exception("An invalid arc found after a null character");
+                    }
+                    size_type pos, size;
+                    size_type value = get_postfix((size_type)-base, pos, size);
+                    if (size != 0) {
+                        throw exception("A non empty tail found after a null character");
+                    }
+                    ++pfx.length;
+                    read_value(value, pfx.value);
+                    return true;
+                }
+            }
+
+            ++pfx.length;
+        }
+
+        if (pfx.query.length() < pfx.length) {
+            pfx.length = pfx.query.length();
+        }
+
+        // An empty key postfix is a prefix of any query.
+        if (is_inline(offset)) {
+            read_value(offset, pfx.value);
+            return true;
+        }
+
+        // Seek to the position of the key postfix in the TAIL.
+        itail tail;
+        tail_reader(tail, offset);
+
+        // Check if two key postfixes are identical.
+        bool match = tail.match_string_partial(&p[pfx.length], m_folded ? m_fold : NULL);
+        if (match) {
+            size_type postfix_size = tail.strlen();
+            pfx.length += postfix_size;
+            // Skip the key postfix.
+            tail.seekg(offset + postfix_size + 1);
+            // Read the value.
+            get_value(tail, pfx.value);
+        }
+        
+        return match;
+    }
+
+    bool next_prefix_binary(prefix_cursor& pfx) const
+    {
+        const char *p = pfx.query.data();
+        size_type length = pfx.query.length();
+
+        if (get_base(pfx.cur) < 0) {
+            // We have already reached a leaf node.
+            return false;
+        }
+
+        while (pfx.length < length) {
+            // Try to descend to the child node.
+            pfx.cur = descend(pfx.cur, (uint8_t)p[pfx.length]);
+            if (pfx.cur == INVALID_INDEX) {
+                return false;
+            }
+            ++pfx.length;
+
+            size_type pos, size;
+            base_type base = get_base(pfx.cur);
+            if (base < 0) {
+                // Check if the key postfix is a prefix of the rest.
+                size_type value = get_postfix((size_type)-base, pos, size);
+                if (size <= length - pfx.length &&
+                    match_bytes(pos, p + pfx.length, size)) {
+                    pfx.length += size;
+                    read_value(value, pfx.value);
+                    return true;
+                }
+                return false;
+            }
+
+            // Check whether a key ends at the node.
+            size_type offset = terminal(pfx.cur);
+            if (offset != 0) {
+                read_value(get_postfix(offset, pos, size), pfx.value);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    inline base_type get_base(size_type i) const
+    {
+        return doublearray_traits::get_base(m_da[i]);
+    }
+
+    inline check_type get_check(size_type i) const
+    {
+        return doublearray_traits::get_check(m_da[i]);
+    }
+
+public:
+    /**
+     * Assigns a double-array trie from a memory image.
+     *  @param  block           The pointer to the memory block.
+     *  @param  size            The size, in bytes, of the memory block.
+     *  @return size_type       If successful, the size, in bytes, of the
+     *                          memory block used to read a double-array trie;
+     *                          otherwise zero.
+     */
+    size_type assign(const char *block, size_type size)
+    {
+        char chunk[4];
+        uint32_t value, sdat_size, total_size;
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(block);
+
+        // The size of the memory block must not be smaller than SDAT_CHUNKSIZE.
+        if (size < SDAT_CHUNKSIZE) {
+            return 0;
+        }
+
+        // Read the "SDAT" chunk.
+        p += read_chunk(p, chunk, total_size);
+        if (std::strncmp(chunk, "SDAT", 4) != 0) {
+            return 0;
+        }
+
+        // Check the size of the "SDAT" chunk.
+        p += read_uint32(p, sdat_size);
+        if (sdat_size != SDAT_CHUNKSIZE) {
+            return 0;
+        }
+
+        // Read the number of records in the trie.
+        p += read_uint32(p, value);
+        m_n = (size_type)value;
+
+        // Jump tables are optional.
+        m_jump1.free();
+        m_jump2.free();
+        m_term.free();
+        m_counts.free();
+        m_pool.assign(NULL, 0);
+        m_flags = 0;
+        m_inline = 0;
+        set_fold(NULL);
+
+        // Loop for child chunks.
+        const uint8_t* last = reinterpret_cast<const uint8_t*>(block) + total_size;
+        while (p < last) {
+            uint32_t size;
+            const uint8_t* q = p;
+            q += read_chunk(q, chunk, size);
+            uint32_t datasize = size - CHUNKSIZE;
+
+            if (strncmp(chunk, "TBLU", 4) == 0) {
+                // "TBLU" chunk.
+                if (datasize == NUMCHARS) {
+                    for (int i = 0;i < NUMCHARS;++i) {
+                        m_table[i] = q[i];
+                    }
+                }
+
+            } else if (strncmp(chunk, doublearray_traits::chunk_id(), 4) == 0) {
+                // "SDA4", "SDA5", or "SDA8" chunk.
+                m_da.assign((element_type*)q, datasize / sizeof(element_type));
+
+            } else if (strncmp(chunk, "TAIL", 4) == 0) {
+                // "TAIL" chunk.
+                m_tail.assign(q, datasize);
+
+            } else if (strncmp(chunk, "FOLD", 4) == 0) {
+                // "FOLD" chunk.
+                if (datasize == NUMCHARS) {
+                    set_fold(q);
+                }
+
+            } else if (strncmp(chunk, "FLAG", 4) == 0) {
+                // "FLAG" chunk.
+                if (datasize == sizeof(uint32_t)) {
+                    read_uint32(q, m_flags);
+                }
+
+            } else if (strncmp(chunk, "VINL", 4) == 0) {
+                // "VINL" chunk.
+                if (datasize == sizeof(uint32_t)) {
+                    read_uint32(q, value);
+                    m_inline = (size_type)value;
+                }
+
+            } else if (strncmp(chunk, "CNTS", 4) == 0) {
+                // "CNTS" chunk.
+                m_counts.assign((uint32_t*)q, datasize / sizeof(uint32_t));
+
+            } else if (strncmp(chunk, "TERM", 4) == 0) {
+                // "TERM" chunk.
+                m_term.assign((uint32_t*)q, datasize / sizeof(uint32_t));
+
+            } else if (strncmp(chunk, "POOL", 4) == 0) {
+                // "POOL" chunk.
+                m_pool.assign(q, datasize);
+
+            } else if (strncmp(chunk, "JMP1", 4) == 0) {
+                // "JMP1" chunk.
+                if (datasize == sizeof(uint32_t) * NUMCHARS) {
+                    m_jump1.assign((uint32_t*)q, NUMCHARS);
+                }
+
+            } else if (strncmp(chunk, "JMP2", 4) == 0) {
+                // "JMP2" chunk.
+                if (datasize == sizeof(uint32_t) * NUMCHARS * NUMCHARS) {
+                    m_jump2.assign((uint32_t*)q, NUMCHARS * NUMCHARS);
+                }
+
+            }
+
+            p += size;
+        }
+
+        // Make sure that arrays are allocated successfully.
+        if (!m_da || !m_tail) {
+            return 0;
+        }
+
+        // Ignore the key counts that do not cover the double array.
+        if (m_counts.size() != m_da.size()) {
+            m_counts.free();
+        }
+
+        return total_size;
+    }
+
+    /**
+     * Read a double-array trie from an input stream.
+     *  @param  is              The input stream.
+     *  @return size_type       The size of the double-array data.
+     */
+    size_type read(std::istream& is)
+    {
+        char chunk[4];
+        uint32_t total_size;
+        uint8_t data[CHUNKSIZE];
+        std::istream::pos_type offset = is.tellg();
+
+        // Read CHUNKSIZE bytes.
+        is.read(reinterpret_cast<char*>(data), CHUNKSIZE);
+        if (is.fail()) {
+            is.seekg(offset, std::ios::beg);
+            return 0;
+        }
+
+        // Parse the data as a chunk.
+        read_chunk(data, chunk, total_size);
+
+        // Make sure that the data is a "SDAT" chunk.
+        if (std::strncmp(chunk, "SDAT", 4) != 0) {
+            is.seekg(offset, std::ios::beg);
+            return 0;
+        }
+
+        // Allocate a new memory block and copy the data.
+        m_block = new char[total_size];
+        m_block_size = total_size;
+        std::memcpy(m_block, data, CHUNKSIZE);
+
+        // Read the actual data.
+        is.read(m_block + CHUNKSIZE, total_size - CHUNKSIZE);
+        if (is.fail()) {
+            is.seekg(offset, std::ios::beg);
+            return 0;
+        }
+
+        // Allocate the trie.
+        size_type used_size = assign(m_block, total_size);
+        if (used_size != total_size) {
+            is.seekg(offset, std::ios::beg);
+            return 0;
+        }
+
+        return used_size;
+    }
+
+protected:
+    size_type read_uint32(const uint8_t* block, uint32_t& value)
+    {
+        return read_data(block, &value, sizeof(value));
+    }
+
+    size_type read_data(const uint8_t* block, void *data, size_t size)
+    {
+        std::memcpy(data, block, size);
+        return size;
+    }
+
+    size_type read_chunk(const uint8_t* block, char *chunk, uint32_t& size)
+    {
+        std::memcpy(chunk, block, 4);
+        read_uint32(block + 4, size);
+        return 8;
+    }
+};
+
+
+
+/**
+ * A builder of a double-array trie.
+ *
+ *  This class builds a double-array trie from records sorted in dictionary
+ *  order of keys.
+ *
+ *  @param  key_tmpl            A type that represents a record key. This type
+ *                              must be either \c char* or \c std::string .
+ *  @param  value_tmpl          A type that represents a record value.
+ *  @param  doublearray_traits  A class in which various properties of
+ *                              double-array elements are described.
+ */
+template <
+    class key_tmpl,
+    class value_tmpl,
+    class doublearray_traits = doublearray5_traits
+>
+class builder
+{
+public:
+    /// A type that represents a record.
+    typedef key_tmpl key_type;
+    /// A type that represents a record value.
+    typedef value_tmpl value_type;
+    /// A type that represents an element of a double array.
+    typedef typename doublearray_traits::element_type element_type;
+    /// A type that represents a base value in a double array.
+    typedef typename doublearray_traits::base_type base_type;
+    /// A type that represents a check value in a double array.
+    typedef typename doublearray_traits::check_type check_type;
+    /// A type that implements a double array.
+    typedef segmented_array<element_type> doublearray_type;
+    /// A type of sizes.
+    typedef typename doublearray_type::size_type size_type;
+
+    /**
+     * A type that represents a record (a pair of key and value).
+     */
+    struct record_type
+    {
+        key_type key;       ///< The key of the record.
+        value_type value;   ///< The value of the record.
+    };
+
+
+    /**
+     * Exception class.
+     */
+    class exception : public std::runtime_error
+    {
+    public:
+        /**
+         * Constructs an instance.
+         *  @param  msg     The error message.
+         */
+        explicit exception(const std::string& msg)
+            : std::runtime_error(msg)
+        {
+        }
+    };
+
+    /**
+     * A distribution of values; the element #i is the number of times that
+     * the value i is observed.
+     */
+    typedef std::vector<size_type> histogram_type;
+
+    /**
+     * Statistics of the double array trie.
+     */
+    struct stat_type
+    {
+        /// The size, in bytes, of the double array.
+        size_type   da_size;
+        /// The number of elements in the double array.
+        size_type   da_num_total;
+        /// The number of elements used actually in the double array.
+        size_type   da_num_used;
+        /// The number of nodes (excluding leaves).
+        size_type   da_num_nodes;
+        /// The number of leaves.
+        size_type   da_num_leaves;
+        /// The number of leaves that store their values in the elements.
+        size_type   da_num_inline;
+        /// The utilization ratio of the double array.
+        double      da_usage;
+        /// The size, in bytes, of the tail array.
+        size_type   tail_size;
+        /// The size, in bytes, of the pool of string values.
+        size_type   pool_size;
+        /// The number of distinct strings in the pool.
+        size_type   pool_num_strings;
+        /// The sum of the number of trials for finding bases.
+        size_type   bt_sum_base_trials;
+        /// The average number of trials for finding bases.
+        double      bt_avg_base_trials;
+        /// The number of top levels measured by da_top_num and da_top_size.
+        size_type   da_top_depth;
+        /// The number of elements in the top levels.
+        size_type   da_top_num;
+        /// The size, in bytes, of the prefix of the double array that
+        /// contains every element in the top levels.
+        size_type   da_top_size;
+        /// The distribution of the depths of nodes (excluding leaves).
+        histogram_type  hist_node_depth;
+        /// The distribution of the numbers of children of nodes.
+        histogram_type  hist_fanout;
+        /// The distribution of the depths of leaves, i.e., the numbers of
+        /// key bytes resolved by the double array.
+        histogram_type  hist_leaf_depth;
+        /// The distribution of the lengths of key postfixes in the TAIL.
+        histogram_type  hist_tail_length;
+        /// The distribution of the distances between the indices of parent
+        /// and child nodes; the element #i counts the distances d such
+        /// that 2^(i-1) <= d < 2^i.
+        histogram_type  hist_child_distance;
+    };
+
+    /**
+     * Orders of arranging nodes in the double array.
+     */
+    enum {
+        /// Depth-first order (default).
+        ORDER_DFS,
+        /// Breadth-first order; upper levels occupy a contiguous prefix.
+        ORDER_BFS,
+    };
+
+    /**
+     * The type of a progress callback function.
+     *  @param  instance    The pointer to a user-defined instance.
+     *  @param  i           The number of records that have already been
+     *                      stored in the trie.
+     *  @param  n           The total number of records to be stored.
+     */
+    typedef void (*callback_type)(void *instance, size_type i, size_type n);
+
+    /**
+     * Phases of building and writing a trie.
+     */
+    enum {
+        /// Building the character table.
+        PHASE_TABLE,
+        /// Arranging nodes in the double array.
+        PHASE_ARRANGE,
+        /// Computing the statistics.
+        PHASE_STAT,
+        /// Writing the trie to a stream.
+        PHASE_WRITE,
+    };
+
+    /**
+     * The type of a phase callback function.
+     *  @param  instance    The pointer to a user-defined instance.
+     *  @param  phase       The phase (one of PHASE_* values).
+     *  @param  begin       \c true when the phase begins; \c false when
+     *                      the phase ends.
+     */
+    typedef void (*phase_callback_type)(void *instance, int phase, bool begin);
+
+protected:
+    struct dlink_element_type
+    {
+        size_type prev;
+        size_type next;
+        dlink_element_type() : prev(0), next(0)
+        {
+        }
+    };
+    typedef segmented_array<dlink_element_type> dlink_type;
+
+    typedef std::vector<bool> baseusage_type;
+
+    /// The number of top levels reported in the statistics.
+    enum { TOP_DEPTH = 3 };
+
+    void* m_instance;
+    callback_type m_callback;
+    void* m_phase_instance;
+    phase_callback_type m_phase_callback;
+    int m_order;
+    int m_jump;
+    bool m_use_pool;
+    bool m_binary;
+    bool m_use_fold;
+    uint8_t m_fold[NUMCHARS];
+    bool m_use_inline;
+    /// The smallest leaf offset that encodes a value, or zero.
+    size_type m_inline_base;
+    bool m_use_counts;
+
+    size_type m_i;
+    size_type m_n;
+
+    doublearray_type m_da;
+    otail m_tail;
+    uint8_t m_table[NUMCHARS];
+
+    typedef std::map<std::string, uint32_t> poolindex_type;
+    otail m_pool;
+    poolindex_type m_pool_index;
+
+    /// Pairs of (node, offset) of keys that end at internal nodes.
+    typedef std::vector<std::pair<uint32_t, uint32_t> > terminals_type;
+    terminals_type m_terms;
+
+    /// The numbers of keys under internal nodes, indexed by nodes.
+    std::vector<uint32_t> m_counts;
+
+    baseusage_type m_used_bases;
+    dlink_type m_elink;
+
+    struct child_type
+    {
+        uint8_t             c;
+        size_type           offset;
+        const record_type*  first;
+        const record_type*  last;
+    };
+
+    struct work_type
+    {
+        size_type           index;
+        size_type           p;
+        const record_type*  first;
+        const record_type*  last;
+    };
+
+    std::vector<work_type> m_works;
+    std::vector<child_type> m_children;
+
+    stat_type m_stat;
+
+public:
+    /**
+     * Constructs a builder.
+     */
+    builder()
+        : m_instance(NULL), m_callback(NULL),
+          m_phase_instance(NULL), m_phase_callback(NULL),
+          m_order(ORDER_DFS), m_jump(0),
+          m_use_pool(false), m_binary(false), m_use_fold(false),
+          m_use_inline(false), m_inline_base(0), m_use_counts(false)
+    {
+    }
+
+    /**
+     * Destructs the builder.
+     */
+    virtual ~builder()
+    {
+    }
+
+    /**
+     * Sets a progress callback.
+     *  @param  instance    The pointer to a user-defined instance.
+     *  @param  callback    The callback function.
+     */
+    void set_callback(void* instance, callback_type callback)
+    {
+        m_instance = instance;
+        m_callback = callback;
+    }
+
+    /**
+     * Sets a callback at the beginning and end of each phase.
+     *  This is useful for measuring the phases separately (e.g., with
+     *  hardware performance counters).
+     *  @param  instance    The pointer to a user-defined instance.
+     *  @param  callback    The callback function.
+     */
+    void set_phase_callback(void* instance, phase_callback_type callback)
+    {
+        m_phase_instance = instance;
+        m_phase_callback = callback;
+    }
+
+    /**
+     * Sets the order of arranging nodes in the double array.
+     *  The breadth-first order places the nodes in the upper levels, which
+     *  every lookup visits, in a small prefix of the double array so that
+     *  they stay in the CPU cache. The depth-first order places siblings
+     *  and descendants closer, which suits traversals of whole subtrees.
+     *  @param  order       The order, ORDER_DFS or ORDER_BFS.
+     */
+    void set_order(int order)
+    {
+        m_order = order;
+    }
+
+    /**
+     * Sets the number of leading bytes resolved by jump tables.
+     *  A jump table maps the first byte(s) of a key directly to the node
+     *  at that depth so that a lookup skips the descents from the root.
+     *  @param  depth       0 (no table), 1 (a table of 256 entries; 1 KB),
+     *                      or 2 (tables of 256 and 65,536 entries; 257 KB).
+     */
+    void set_jump(int depth)
+    {
+        m_jump = depth;
+    }
+
+    /**
+     * Enables the pool of string values.
+     *  The builder stores every distinct value string once in a "POOL"
+     *  chunk, and a leaf refers to its value by an offset into the pool,
+     *  encoded in one to five bytes. This is effective only when the value type is \c char* or
+     *  \c std::string, and reduces the TAIL array greatly when many records
+     *  share values (e.g., part-of-speech tags).
+     *  @param  pool        \c true to enable the pool.
+     */
+    void set_pool(bool pool)
+    {
+        m_use_pool = pool;
+    }
+
+    /**
+     * Enables binary keys.
+     *  Keys are delimited by their lengths instead of null characters, so
+     *  that they may contain any bytes (e.g., big-endian integers or
+     *  hashes). Use \c std::string as the key type to store null
+     *  characters. The end of a key that is a prefix of another key is
+     *  marked by a list of terminal nodes ("TERM" chunk) instead of an arc
+     *  for '\0'. Jump tables are not written for binary keys. A trie reads
+     *  the mode from the "FLAG" chunk; write the trie and read it back, or
+     *  assign the builder to the trie by trie::assign(), to look up binary
+     *  keys.
+     *  @param  binary      \c true to enable binary keys.
+     */
+    void set_binary(bool binary)
+    {
+        m_binary = binary;
+    }
+
+    /**
+     * Enables values stored in leaf elements.
+     *  A leaf whose key postfix is empty stores the value of its record in
+     *  the BASE instead of the TAIL, so that a look-up ending at the leaf
+     *  reads no TAIL. This is effective only when the value type has a
+     *  specialization of dastrie::inline_value_traits (dastrie::empty_type
+     *  and integer types). The values of the records are encoded into the
+     *  top of the BASE range, and the TAIL must fit below them; a value
+     *  whose code exceeds half of the range is stored in the TAIL. A trie
+     *  reads the start of the range from the "VINL" chunk; write the trie
+     *  and read it back, or assign the builder to the trie by
+     *  trie::assign(), to look up the records.
+     *  @param  inline_values   \c true to enable values in leaf elements.
+     */
+    void set_inline_values(bool inline_values)
+    {
+        m_use_inline = inline_values;
+    }
+
+    /**
+     * Enables the numbers of keys under internal nodes.
+     *  The builder stores the number of keys in the subtree of every
+     *  internal node in a "CNTS" chunk of 4 bytes per element, so that
+     *  trie::count_prefix() finds the number of keys that start with a
+     *  prefix after descending the prefix once.
+     *  @param  counts      \c true to store the numbers of keys.
+     */
+    void set_counts(bool counts)
+    {
+        m_use_counts = counts;
+    }
+
+    /**
+     * Sets a folding map for queries (e.g., case folding).
+     *  The folding map maps every byte to the byte that it folds into. The
+     *  character table maps the bytes that fold into the same byte to the
+     *  same code, so that a query descends the trie as if it were folded
+     *  (e.g., "Apple" finds the key "apple" with a lower-casing map), and
+     *  the key postfixes in the TAIL are compared with the folded bytes
+     *  of the query. Keys must be folded already (e.g., lower case), and
+     *  sorted after folding. The map is stored in a "FOLD" chunk.
+     *  @param  fold        The pointer to the array of #NUMCHARS bytes, or
+     *                      \c NULL to disable folding.
+     *  @throw  exception   If the map does not map '\0' to '\0', or folds a
+     *                      byte into a byte that is folded further.
+     */
+    void set_fold(const uint8_t* fold)
+    {
+        m_use_fold = (fold != NULL);
+        if (m_use_fold) {
+            for (int i = 0;i < NUMCHARS;++i) {
+                if (fold[fold[i]] != fold[i] || (i == 0 && fold[i] != 0)) {
+                    throw exception("The folding map is not idempotent");
+                }
+                m_fold[i] = fold[i];
+            }
+        }
+    }
+
+    /**
+     * Estimates the size of a double-array trie before building it.
+     *  This function scans the records once and counts the nodes of the
+     *  trie from the longest common prefixes of adjacent keys, and the size
+     *  of the TAIL array from the remaining key postfixes and values. The
+     *  number of elements includes a margin for vacant elements.
+     *  @param  first       The pointer addressing the first record.
+     *  @param  last        The pointer addressing the position one past the
+     *                      final record.
+     *  @param[out] num_elements    The estimated number of elements.
+     *  @param[out] tail_bytes      The estimated size, in bytes, of the TAIL.
+     *  @return bool        \c true if the trie is expected to fit into the
+     *                      capacity of the double-array traits.
+     */
+    bool estimate(
+        const record_type* first,
+        const record_type* last,
+        size_type& num_elements,
+        size_type& tail_bytes
+        ) const
+    {
+        otail value;
+        size_type num_used = 1;
+        size_type prev_lcp = 0;
+
+        tail_bytes = 1;
+        for (const record_type* it = first;it != last;++it) {
+            // The longest common prefix with the next key.
+            size_type length = key_length(it->key), next_lcp = 0;
+            if (it + 1 != last) {
+                const record_type* next = it + 1;
+                while (it->key[next_lcp] && it->key[next_lcp] == next->key[next_lcp]) {
+                    ++next_lcp;
+                }
+            }
+
+            // The key reaches its leaf after (depth) characters, and adds
+            // the nodes deeper than the common prefix with the previous key.
+            size_type depth = std::max(prev_lcp, next_lcp) + 1;
+            if (first + 1 == last) {
+                depth = 0;
+            }
+            num_used += depth - prev_lcp;
+            tail_bytes += (depth < length ? length - depth : 0) + 1;
+
+            value.clear();
+            value << it->value;
+            tail_bytes += value.bytes();
+
+            prev_lcp = next_lcp;
+        }
+
+        // Allow 1/8 of the elements to be vacant.
+        num_elements = num_used + num_used / 8 + NUMCHARS;
+        return (
+            num_elements < (size_type)doublearray_traits::max_base() &&
+            tail_bytes <= (size_type)doublearray_traits::max_base()
+            );
+    }
+
+    /**
+     * Builds a double-array trie from sorted records.
+     *  @param  first       The pointer addressing the first record.
+     *  @param  last        The pointer addressing the position one past the
+     *                      final record.
+     */
+    void build(const record_type* first, const record_type* last)
+    {
+        clear();
+
+        m_i = 0;
+        m_n = (size_t)(last - first);
+        phase(PHASE_TABLE, true);
+        build_table(m_table, first, last, m_use_fold ? m_fold : NULL);
+        if (m_use_inline) {
+            m_inline_base = inline_base(first, last);
+        }
+        phase(PHASE_TABLE, false);
+
+        // Create the initial node.
+        phase(PHASE_ARRANGE, true);
+        da_expand(INITIAL_INDEX+1);
+        vlist_expand(INITIAL_INDEX+1);
+        set_base(INITIAL_INDEX, 1);
+        vlist_use(INITIAL_INDEX);
+        arrange(first, last);
+        phase(PHASE_ARRANGE, false);
+
+        // 
+        phase(PHASE_STAT, true);
+        compute_stat();
+        phase(PHASE_STAT, false);
+    }
+
+    /**
+     * Initializes the double array.
+     */
+    void clear()
+    {
+        // Initialize the character table.
+        for (int i = 0;i < NUMCHARS;++i) {
+            m_table[i] = i;
+        }
+
+        // Initialize the double array.
+        m_da.clear();
+        da_expand(1);
+
+        // Initialize the tail array.
+        m_tail.clear();
+        m_tail.write<uint8_t>(0);
+
+        // Initialize the pool of string values.
+        m_pool.clear();
+        m_pool_index.clear();
+
+        // Initialize the list of terminal nodes.
+        m_terms.clear();
+        m_inline_base = 0;
+
+        // Initialize the numbers of keys under nodes.
+        m_counts.clear();
+
+        // Initialize the vacant linked list.
+        vlist_init();
+
+        // Initialize the statistics.
+        m_stat = stat_type();
+    }
+
+    /**
+     * Obtains a read-only access to the double-array.
+     *  @return const doublearray_type& The reference to the double array.
+     */
+    const doublearray_type& doublearray() const
+    {
+        return m_da;
+    }
+
+    /**
+     * Obtains a read-only access to the tail array.
+     *  @return const otail&    The reference to the tail array.
+     */
+    const otail& tail() const
+    {
+        return m_tail;
+    }
+
+    /**
+     * Obtains a read-only access to the pool of string values.
+     *  @return const otail&    The reference to the pool, which is empty
+     *                          unless the pool is enabled by set_pool().
+     */
+    const otail& pool() const
+    {
+        return m_pool;
+    }
+
+    /**
+     * Obtains a read-only access to the character table.
+     *  @return const uint8_t*  The pointer to the character table.
+     */
+    const uint8_t* table() const
+    {
+        return m_table;
+    }
+
+    /**
+     * Obtains a read-only access to the folding map.
+     *  @return const uint8_t*  The pointer to the folding map, or \c NULL
+     *                          if no folding map is set by set_fold().
+     */
+    const uint8_t* fold() const
+    {
+        return m_use_fold ? m_fold : NULL;
+    }
+
+    /**
+     * Checks whether the builder stores binary keys.
+     *  @return bool            \c true if binary keys are enabled by
+     *                          set_binary().
+     */
+    bool binary() const
+    {
+        return m_binary;
+    }
+
+    /**
+     * Obtains the start of the values stored in leaf elements.
+     *  @return size_type       The leaf offset that encodes the value code
+     *                          zero, or zero if no value is stored in a
+     *                          leaf element.
+     */
+    size_type inline_base() const
+    {
+        return m_inline_base;
+    }
+
+    /**
+     * Obtains the numbers of keys under the elements of the double array.
+     *  @param  counts          The vector that receives the number of keys
+     *                          for every element, as stored in the "CNTS"
+     *                          chunk, or an empty vector unless the numbers
+     *                          are enabled by set_counts().
+     */
+    void counts(std::vector<uint32_t>& counts) const
+    {
+        counts.clear();
+        if (m_use_counts) {
+            counts = m_counts;
+            counts.resize(m_da.size(), 0);
+        }
+    }
+
+    /**
+     * Obtains the jump tables.
+     *  @param  jump1           The vector that receives the "JMP1" table,
+     *                          or an empty vector if no table is built.
+     *  @param  jump2           The vector that receives the "JMP2" table,
+     *                          or an empty vector if no table is built.
+     */
+    void jump_tables(std::vector<uint32_t>& jump1, std::vector<uint32_t>& jump2) const
+    {
+        jump1.clear();
+        jump2.clear();
+
+        // Build jump tables only when the root node has children.
+        if (0 < m_jump && !m_binary && 0 < get_base(INITIAL_INDEX)) {
+            build_jump(jump1, jump2);
+        }
+    }
+
+    /**
+     * Obtains the terminal nodes of binary keys.
+     *  @param  terms           The vector that receives the pairs of the
+     *                          index of a terminal node and the offset of
+     *                          its value, in the order of the indices, as
+     *                          stored in the "TERM" chunk.
+     */
+    void terminals(std::vector<uint32_t>& terms) const
+    {
+        terminals_type sorted(m_terms);
+        std::sort(sorted.begin(), sorted.end());
+        terms.clear();
+        for (size_type i = 0;i < sorted.size();++i) {
+            terms.push_back(sorted[i].first);
+            terms.push_back(sorted[i].second);
+        }
+    }
+
+    const stat_type& stat() const
+    {
+        return m_stat;
+    }
+
+protected:
+    /*
+     * Arranges nodes with an explicit list of work items instead of
+     * recursion, so that keys of any length never exhaust the stack. The
+     * list works as a stack for the depth-first order, and as a queue for
+     * the breadth-first order; in the latter, since every base address is
+     * chosen by the first fit from the head of the vacant list, the nodes
+     * in upper levels occupy a small prefix of the double array.
+     */
+    void arrange(const record_type* first, const record_type* last)
+    {
+        std::vector<work_type>& works = m_works;
+        std::vector<child_type>& children = m_children;
+        size_type head = 0;
+        work_type work;
+
+        works.clear();
+        work.index = INITIAL_INDEX;
+        work.p = 0;
+        work.first = first;
+        work.last = last;
+        works.push_back(work);
+
+        while (head < works.size()) {
+            if (m_order == ORDER_BFS) {
+                // Discard the items consumed when they fill half the list.
+                if (NUMCHARS < head && works.size() < head * 2) {
+                    works.erase(works.begin(), works.begin() + head);
+                    head = 0;
+                }
+                work = works[head++];
+            } else {
+                work = works.back();
+                works.pop_back();
+            }
+
+            // If the given range [first, last) points to a single record,
+            // i.e., (first + 1 == last), store the key postfix and value of
+            // the record to the TAIL array; let the current node as a leaf
+            // node addressing to the offset from which (*first) are stored
+            // in the TAIL array.
+            if (work.first + 1 == work.last) {
+                set_leaf(work.index, work.p, *work.first);
+                continue;
+            }
+
+            // Record the number of keys under the current node.
+            if (m_use_counts) {
+                if (m_counts.size() <= work.index) {
+                    m_counts.resize(work.index + 1, 0);
+                }
+                m_counts[work.index] = (uint32_t)(work.last - work.first);
+            }
+
+            // For binary keys, a key that ends at this node sorts first in
+            // the range; store it in the TAIL and mark the node terminal.
+            if (m_binary && key_length(work.first->key) == work.p) {
+                size_type offset = (size_type)-arrange_leaf(work.p, *work.first);
+                m_terms.push_back(std::make_pair(
+                    (uint32_t)work.index, (uint32_t)offset));
+                if (key_length((++work.first)->key) == work.p) {
+                    throw exception("Duplicated keys detected");
+                }
+            }
+
+            // Build a list of child nodes of the current node, and find a
+            // base address that can store every child.
+            size_type num_children = get_children(
+                children, work.p, work.first, work.last);
+            size_type base = place(&children[0], num_children);
+            set_base(work.index, (base_type)base);
+
+            // Set CHECK values of child nodes, and queue the descendants.
+            // Child nodes are pushed in reverse order for the depth-first
+            // order so that they are popped in the order of characters.
+            for (size_type i = 0;i < num_children;++i) {
+                const child_type& child = children[i];
+                size_type offset = child.offset;
+                if (child.c == 0 && !m_binary) {
+                    if (child.first + 1 != child.last) {
+                        throw exception("Duplicated keys detected");
+                    }
+                    // Force to insert '\0' in the TAIL.
+                    set_leaf(base + offset, work.p, *child.first);
+                }
+                set_check(base + offset, (uint8_t)(offset - 1));
+                size_type index = base + offset;
+                observe(m_stat.hist_child_distance, bit_length(
+                    work.index < index ? index - work.index : work.index - index));
+            }
+            for (size_type i = 0;i < num_children;++i) {
+                const child_type& child =
+                    children[m_order == ORDER_BFS ? i : num_children - i - 1];
+                if (child.c != 0 || m_binary) {
+                    work_type next;
+                    next.index = base + child.offset;
+                    next.p = work.p + 1;
+                    next.first = child.first;
+                    next.last = child.last;
+                    works.push_back(next);
+                }
+            }
+
+            ++m_stat.da_num_nodes;
+            observe(m_stat.hist_node_depth, work.p);
+            observe(m_stat.hist_fanout, num_children);
+        }
+    }
+
+    void set_leaf(size_type index, size_type p, const record_type& rec)
+    {
+        set_base(index, arrange_leaf(p, rec));
+
+        // Store the first bytes of the postfix of a text key (padded with
+        // null characters) in the element, if the element has the room.
+        const int n = doublearray_traits::inline_size();
+        if (0 < n && !m_binary) {
+            uint8_t inl[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+            size_type length = key_length(rec.key) - p;
+            const char *postfix = key_data(rec.key) + p;
+            for (int i = 0;i < n && (size_type)i < length;++i) {
+                inl[i] = (uint8_t)postfix[i];
+            }
+            doublearray_traits::set_inline(m_da[index], inl);
+        }
+    }
+
+    base_type arrange_leaf(size_type p, const record_type& rec)
+    {
+        base_type base = 0;
+        size_type length = key_length(rec.key) - p;
+        uint32_t code = 0;
+
+        if (length == 0 && 0 < m_inline_base &&
+            inline_value_traits<value_type>::encode(rec.value, code) &&
+            code <= (size_type)doublearray_traits::max_base() - m_inline_base) {
+            // Store the value in the leaf element instead of the TAIL.
+            base = -(base_type)(m_inline_base + code);
+            ++m_stat.da_num_inline;
+        } else {
+            size_t offset = m_tail.tellp();
+            if ((size_t)doublearray_traits::max_base() < offset) {
+                throw exception("The double array has no space to store leaves");
+            }
+            if (m_binary) {
+                // Write the length of the key postfix followed by the postfix.
+                write_varint((uint32_t)length);
+                m_tail.write(key_data(rec.key) + p, length);
+            } else {
+                m_tail.write_string(rec.key, p);
+            }
+            write_value(rec.value);
+            if (0 < m_inline_base && m_inline_base <= m_tail.tellp()) {
+                throw exception("The tail array has no space below the values in leaves");
+            }
+            base = -(base_type)offset;
+            observe(m_stat.hist_tail_length, length);
+        }
+
+        if (m_callback != NULL) {
+            m_callback(m_instance, ++m_i, m_n);
+        }
+        ++m_stat.da_num_leaves;
+        observe(m_stat.hist_leaf_depth, p);
+        return base;
+    }
+
+    /*
+     * Finds the smallest leaf offset that encodes a value so that the codes
+     * of the values take the top of the BASE range, but no more than half.
+     */
+    size_type inline_base(const record_type* first, const record_type* last) const
+    {
+        if (!inline_value_traits<value_type>::available) {
+            return 0;
+        }
+
+        size_type range = ((size_type)doublearray_traits::max_base() + 1) / 2;
+        size_type num_codes = 0;
+        for (const record_type* it = first;it != last;++it) {
+            uint32_t code;
+            if (inline_value_traits<value_type>::encode(it->value, code) &&
+                (size_type)code < range && num_codes <= (size_type)code) {
+                num_codes = (size_type)code + 1;
+            }
+        }
+        if (num_codes == 0) {
+            return 0;
+        }
+        return (size_type)doublearray_traits::max_base() + 1 - num_codes;
+    }
+
+    static void observe(histogram_type& hist, size_type value)
+    {
+        if (hist.size() <= value) {
+            hist.resize(value + 1, 0);
+        }
+        ++hist[value];
+    }
+
+    static size_type bit_length(size_type value)
+    {
+        size_type n = 0;
+        for (;value != 0;value >>= 1) {
+            ++n;
+        }
+        return n;
+    }
+
+    template <class type>
+    void write_value(const type& value)
+    {
+        m_tail << value;
+    }
+
+    void write_value(char* const& value)
+    {
+        if (m_use_pool) {
+            write_varint(intern(value));
+        } else {
+            m_tail << value;
+        }
+    }
+
+    void write_value(const std::string& value)
+    {
+        if (m_use_pool) {
+            write_varint(intern(value));
+        } else {
+            m_tail << value;
+        }
+    }
+
+    /*
+     * Writes an integer (an offset in the pool or the length of a binary
+     * postfix) with 7 bits per byte, lower bits first; the most significant
+     * bit of a byte indicates that a byte follows. Offsets of values that
+     * appear first are small and take fewer bytes.
+     */
+    void write_varint(uint32_t v)
+    {
+        while (0x80 <= v) {
+            m_tail.write<uint8_t>((uint8_t)(v & 0x7F) | 0x80);
+            v >>= 7;
+        }
+        m_tail.write<uint8_t>((uint8_t)v);
+    }
+
+    static size_type key_length(const char *key)
+    {
+        return std::strlen(key);
+    }
+
+    static size_type key_length(const std::string& key)
+    {
+        return key.length();
+    }
+
+    static const char* key_data(const char *key)
+    {
+        return key;
+    }
+
+    static const char* key_data(const std::string& key)
+    {
+        return key.data();
+    }
+
+    uint32_t intern(const std::string& value)
+    {
+        typename poolindex_type::const_iterator it = m_pool_index.find(value);
+        if (it != m_pool_index.end()) {
+            return it->second;
+        }
+        if (0xFFFFFFFF < m_pool.tellp()) {
+            throw exception("The pool has no space to store values");
+        }
+        uint32_t ref = (uint32_t)m_pool.tellp();
+        m_pool.write_string(value);
+        m_pool_index.insert(typename poolindex_type::value_type(value, ref));
+        return ref;
+    }
+
+    size_type get_children(
+        std::vector<child_type>& children,
+        size_type p,
+        const record_type* first,
+        const record_type* last
+        )
+    {
+        const record_type* it;
+        const uint8_t* table = m_table;
+
+        // Build a list of child nodes of the current node, and obtain the
+        // range of records that each child node owns. Child nodes consist
+        // of a set of characters at records[i].key[p] for i in [begin, end).
+        int pc = -1;
+        children.clear();
+        for (it = first;it != last;++it) {
+            int c = (int)(uint8_t)it->key[p];
+            if (pc < c) {
+                if (!children.empty()) {
+                    children.back().last = it;
+                }
+                child_type child;
+                child.first = it;
+                child.c = (uint8_t)c;
+                child.offset = (size_type)table[c] + 1;
+                children.push_back(child);
+            } else if (c < pc) {
+                throw exception("The records are not sorted in dictionary order of keys");
+            }
+            pc = c;
+        }
+        children.back().last = it;
+        return children.size();
+    }
+
+    size_type place(const child_type* children, size_type num_children)
+    {
+        size_type i;
+        size_type max_offset = 0;
+        for (i = 0;i < num_children;++i) {
+            if (max_offset < children[i].offset) {
+                max_offset = children[i].offset;
+            }
+        }
+
+        // Find the minimum of the base address (base) that can store every
+        // child. This step would be very time consuming if we tried base
+        // indexes from 1 one by one and tested the vacanies for child nodes.
+        // Instead, we try to determine the index number of the first child-
+        // node by using a double-linked list of vacant nodes, and calculate
+        // back the base address from the index number of the child node.
+        size_type base = 0, index = 0;
+        for (;;) {
+            ++m_stat.bt_sum_base_trials;
+
+            // Obtain the index value of a next vacant node.
+            index = vlist_next(index);
+
+            // A base value must be greater than 1.
+            if (index < INITIAL_INDEX + children[0].offset) {
+                // The index is too small for a base value; try next.
+                continue;
+            }
+
+            // Calculate back the base value from the index.
+            base = index - children[0].offset;
+
+            // A base value must not be used by other places.
+            if (base < m_used_bases.size() && m_used_bases[base]) {
+                continue;
+            }
+
+            // Expand the double array and vacant list if necessary.
+            da_expand(base + max_offset + 1);
+            vlist_expand(base + max_offset + 1);
+
+            // Check if the base address can store every child in the list.
+            for (i = 1;i < num_children;++i) {
+                size_type offset = children[i].offset;
+                if (da_in_use(base + offset)) {
+                    break;
+                }
+            }
+
+            // Exit the loop if successful.
+            if (i == num_children) {
+                break;
+            }
+        }
+
+        // Fail if the double array could not store the child nodes.
+        if ((size_type)doublearray_traits::max_base() <= base + max_offset) {
+            throw exception("The double array has no space to store child nodes");
+        }
+
+        // Register the usage of the base address.
+        if (m_used_bases.size() <= base) {
+            m_used_bases.resize(base+1, false);
+        }
+        m_used_bases[base] = true;
+
+        // Reserve the double-array elements for the child nodes by filling
+        // BASE = 1 tentatively. This step protects these elements from being
+        // used by the descendant nodes.
+        for (i = 0;i < num_children;++i) {
+            size_type offset = children[i].offset;
+            set_base(base + offset, 1);
+            vlist_use(base + offset);
+        }
+        return base;
+    }
+
+    void compute_stat()
+    {
+        m_stat.da_size = sizeof(m_da[0]) * m_da.size();
+        m_stat.da_num_total = m_da.size();
+        for (size_type i = 0;i < m_da.size();++i) {
+            if (da_in_use(i)) {
+                ++m_stat.da_num_used;
+            }
+        }
+        m_stat.da_usage = m_stat.da_num_used / (double)m_stat.da_num_total;
+        m_stat.tail_size = m_tail.bytes();
+        m_stat.pool_size = m_pool.bytes();
+        m_stat.pool_num_strings = m_pool_index.size();
+        m_stat.bt_avg_base_trials = m_stat.bt_sum_base_trials / (double)m_stat.da_num_total;
+
+        // Measure the region occupied by the elements in the top levels.
+        size_type max_index = INITIAL_INDEX;
+        std::vector<size_type> level, next;
+        level.push_back(INITIAL_INDEX);
+        m_stat.da_top_depth = TOP_DEPTH;
+        for (size_type d = 0;d < TOP_DEPTH && !level.empty();++d) {
+            next.clear();
+            for (size_type i = 0;i < level.size();++i) {
+                size_type cur = level[i];
+                ++m_stat.da_top_num;
+                if (max_index < cur) {
+                    max_index = cur;
+                }
+                base_type base = get_base(cur);
+                for (int c = 0;0 < base && c < NUMCHARS;++c) {
+                    size_type child = (size_type)base + c + 1;
+                    if (da_in_use(child) && get_check(child) == (check_type)c) {
+                        next.push_back(child);
+                    }
+                }
+            }
+            level.swap(next);
+        }
+        m_stat.da_top_size = sizeof(m_da[0]) * (max_index + 1);
+    }
+
+protected:
+    inline base_type get_base(size_type i) const
+    {
+        return doublearray_traits::get_base(m_da[i]);
+    }
 
-            } else if (strncmp(chunk, doublearray_traits::chunk_id(), 4) == 0) {
-                // "SDA4" or "SDA5" chunk.
-                m_da.assign((element_type*)q, datasize / sizeof(element_type));
+    inline check_type get_check(size_type i) const
+    {
+        return doublearray_traits::get_check(m_da[i]);
+    }
+
+    inline void set_base(size_type i, base_type v)
+    {
+        doublearray_traits::set_base(m_da[i], v);
+    }
+
+    inline void set_check(size_type i, check_type v)
+    {
+        doublearray_traits::set_check(m_da[i], v);
+    }
+
+    inline bool da_in_use(size_type i) const
+    {
+        return (i < m_da.size() && get_base(i) != 0);
+    }
+
+    inline void da_expand(size_type size)
+    {
+        if (m_da.size() < size) {
+            m_da.resize(size, doublearray_traits::default_value());
+        }
+    }
+
+    void vlist_init()
+    {
+        m_elink.resize(1);
+        m_elink[0].next = 1;
+        m_elink[0].prev = 0;
+    }
+
+    inline size_type vlist_next(size_type i)
+    {
+        return (i < m_elink.size()) ? m_elink[i].next : i+1;
+    }
+
+    void vlist_expand(size_type size)
+    {
+        if (m_elink.size() < size) {
+            size_type first = m_elink.size();
+            m_elink.resize(size);
+
+            size_type back = m_elink[0].prev;
+            for (size_type i = first;i < m_elink.size();++i) {
+                m_elink[i].prev = back;
+                m_elink[i].next = i+1;
+                back = i;
+            }
+            m_elink[0].prev = m_elink.size()-1;
+        }
+    }
+
+    void vlist_use(size_type i)
+    {
+        size_type prev = m_elink[i].prev;
+        size_type next = m_elink[i].next;
+        if (m_elink.size() <= next) {
+            m_elink.resize(next+1);
+            m_elink[next].next = next+1;
+            m_elink[0].prev = next; // The rightmost vacant node.
+        }
+        m_elink[prev].next = next;
+        m_elink[next].prev = prev;
+    }
+
+protected:
+    struct unigram_freq
+    {
+        int c;          ///< Character code.
+        double freq;    ///< Frequency.
+    };
+
+    static bool comp_freq(const unigram_freq& x, const unigram_freq& y)
+    {
+        return x.freq > y.freq;
+    }
+
+    void build_table(
+        uint8_t *table,
+        const record_type* first,
+        const record_type* last,
+        const uint8_t* fold = NULL
+        )
+    {
+        unigram_freq st[NUMCHARS];
+
+        // Initialize the frequency table.
+        for (int i = 0;i < NUMCHARS;++i) {
+            st[i].c = i;
+            st[i].freq = 0.;
+        }
+
+        // Count the frequency of occurrences of characters.
+        for (const record_type* it = first;it != last;++it) {
+            size_type length = key_length(it->key);
+            for (size_type i = 0;i < length;++i) {
+                int c = (int)(uint8_t)it->key[i];
+                if (fold != NULL && fold[c] != c) {
+                    throw exception("The keys are not folded by the folding map");
+                }
+                ++st[c].freq;
+            }
+            ++st[0].freq;
+        }
+
+        // Sort the frequency table.
+        std::sort(&st[0], &st[NUMCHARS], comp_freq);
+
+        // 
+        for (int i = 0;i < NUMCHARS;++i) {
+            table[st[i].c] = (uint8_t)i;
+        }
+
+        // Map the bytes to the codes of the bytes that they fold into.
+        if (fold != NULL) {
+            for (int c = 0;c < NUMCHARS;++c) {
+                table[c] = table[fold[c]];
+            }
+        }
+    }
+
+
+public:
+    /**
+     * Writes out the double-array trie to an output stream.
+     *  @param  os      The output stream.
+     */
+    void write(std::ostream& os)
+    {
+        phase(PHASE_WRITE, true);
+
+        // Calculate the size of each chunk.
+        size_type sda_size = CHUNKSIZE + sizeof(m_da[0]) * m_da.size();
+        size_type tblu_size = CHUNKSIZE + sizeof(uint8_t) * NUMCHARS;
+        size_type tail_size = CHUNKSIZE +  m_tail.bytes();
+        size_type total_size = SDAT_CHUNKSIZE + tblu_size + sda_size + tail_size;
+
+        std::vector<uint32_t> jump1, jump2;
+        jump_tables(jump1, jump2);
+        size_type jmp1_size = jump1.empty() ? 0 : CHUNKSIZE + sizeof(uint32_t) * jump1.size();
+        size_type jmp2_size = jump2.empty() ? 0 : CHUNKSIZE + sizeof(uint32_t) * jump2.size();
+        size_type pool_size = m_pool.bytes() == 0 ? 0 : CHUNKSIZE + m_pool.bytes();
+        size_type fold_size = m_use_fold ? CHUNKSIZE + sizeof(uint8_t) * NUMCHARS : 0;
+        total_size += jmp1_size + jmp2_size + pool_size + fold_size;
+
+        // Binary keys need "FLAG" and "TERM" chunks.
+        size_type flag_size = m_binary ? CHUNKSIZE + sizeof(uint32_t) : 0;
+        size_type term_size = m_binary ? CHUNKSIZE + sizeof(uint32_t) * 2 * m_terms.size() : 0;
+        size_type vinl_size = 0 < m_inline_base ? CHUNKSIZE + sizeof(uint32_t) : 0;
+        total_size += flag_size + term_size + vinl_size;
+
+        // The numbers of keys cover every element of the double array.
+        std::vector<uint32_t> cnts;
+        counts(cnts);
+        size_type cnts_size = cnts.empty() ? 0 : CHUNKSIZE + sizeof(uint32_t) * cnts.size();
+        total_size += cnts_size;
+
+        // Write a "SDAT" chunk.
+        write_chunk(os, "SDAT", total_size);
+        write_uint32(os, (uint32_t)SDAT_CHUNKSIZE);
+        write_uint32(os, (uint32_t)m_n);
+
+        // Write a "TBLU" chunk.
+        write_chunk(os, "TBLU", tblu_size);
+        write_data(os, m_table, tblu_size - CHUNKSIZE);
+
+        // Write a "FOLD" chunk (if any).
+        if (0 < fold_size) {
+            write_chunk(os, "FOLD", fold_size);
+            write_data(os, m_fold, fold_size - CHUNKSIZE);
+        }
+
+        // Write "FLAG" and "TERM" chunks (if any) at 4-byte aligned offsets.
+        if (0 < flag_size) {
+            write_chunk(os, "FLAG", flag_size);
+            write_uint32(os, (uint32_t)FLAG_BINARY);
+        }
+        if (0 < term_size) {
+            std::vector<uint32_t> terms;
+            terminals(terms);
+            write_chunk(os, "TERM", term_size);
+            for (size_type i = 0;i < terms.size();++i) {
+                write_uint32(os, terms[i]);
+            }
+        }
+
+        // Write a "VINL" chunk (if any).
+        if (0 < vinl_size) {
+            write_chunk(os, "VINL", vinl_size);
+            write_uint32(os, (uint32_t)m_inline_base);
+        }
+
+        // Write a "CNTS" chunk (if any).
+        if (0 < cnts_size) {
+            write_chunk(os, "CNTS", cnts_size);
+            write_data(os, &cnts[0], cnts_size - CHUNKSIZE);
+        }
+
+        // Write "JMP1" and "JMP2" chunks (if any) at 4-byte aligned offsets.
+        if (0 < jmp1_size) {
+            write_chunk(os, "JMP1", jmp1_size);
+            write_data(os, &jump1[0], jmp1_size - CHUNKSIZE);
+        }
+        if (0 < jmp2_size) {
+            write_chunk(os, "JMP2", jmp2_size);
+            write_data(os, &jump2[0], jmp2_size - CHUNKSIZE);
+        }
+
+        // Write a chunk for the double array segment by segment.
+        write_chunk(os, doublearray_traits::chunk_id(), sda_size);
+        for (size_type i = 0;i < m_da.num_segments();++i) {
+            write_data(os, m_da.segment(i), sizeof(m_da[0]) * m_da.segment_size(i));
+        }
+
+        // Write a chunk for the tail array.
+        write_chunk(os, "TAIL", tail_size);
+        write_data(os, m_tail.block(), tail_size - CHUNKSIZE);
+
+        // Write a "POOL" chunk (if any).
+        if (0 < pool_size) {
+            write_chunk(os, "POOL", pool_size);
+            write_data(os, m_pool.block(), pool_size - CHUNKSIZE);
+        }
+
+        phase(PHASE_WRITE, false);
+    }
+
+protected:
+    size_type descend(size_type i, uint8_t c) const
+    {
+        base_type base = get_base(i);
+        if (base <= 0) {
+            return INVALID_INDEX;
+        }
+        size_type next = (size_type)base + m_table[c] + 1;
+        if (!da_in_use(next) || get_check(next) != (check_type)m_table[c]) {
+            return INVALID_INDEX;
+        }
+        return next;
+    }
+
+    /*
+     * An entry of JMP1 is the index of the node reached by the first byte.
+     * An entry of JMP2 is (index << 1) | (the number of bytes consumed - 1),
+     * since the first byte may reach a leaf. Zero means no such node.
+     */
+    void build_jump(std::vector<uint32_t>& jump1, std::vector<uint32_t>& jump2) const
+    {
+        jump1.assign(NUMCHARS, 0);
+        for (int c = 0;c < NUMCHARS;++c) {
+            jump1[c] = (uint32_t)descend(INITIAL_INDEX, (uint8_t)c);
+        }
+
+        // The index and flag must fit into an entry.
+        if (m_jump < 2 || 0x7FFFFFFF < m_da.size()) {
+            return;
+        }
+        jump2.assign(NUMCHARS * NUMCHARS, 0);
+        for (int c = 1;c < NUMCHARS;++c) {
+            size_type cur = jump1[c];
+            if (cur == INVALID_INDEX) {
+                continue;
+            }
+            for (int d = 0;d < NUMCHARS;++d) {
+                uint32_t& entry = jump2[(c << 8) | d];
+                if (get_base(cur) < 0) {
+                    entry = (uint32_t)(cur << 1);
+                } else {
+                    size_type next = descend(cur, (uint8_t)d);
+                    if (next != INVALID_INDEX) {
+                        entry = (uint32_t)((next << 1) | 1);
+                    }
+                }
+            }
+        }
+    }
+
+    inline void phase(int p, bool begin)
+    {
+        if (m_phase_callback != NULL) {
+            m_phase_callback(m_phase_instance, p, begin);
+        }
+    }
+
+    void write_uint32(std::ostream& os, uint32_t value)
+    {
+        write_data(os, &value, sizeof(value));
+    }
+
+    void write_data(std::ostream& os, const void *data, size_t size)
+    {
+        os.write(reinterpret_cast<const char*>(data), size);
+    }
+
+    void write_chunk(std::ostream& os, const char *chunk, size_type size)
+    {
+        os.write(chunk, 4);
+        write_uint32(os, (uint32_t)size);
+    }
+};
+
+/**
+ * Empty type.
+ *  Specify this class as a value type of dastrie::trie and dastrie::builder
+ *  to make these class behave as a set (e.g., std::set) rather than a map.
+ */
+struct empty_type
+{
+    empty_type(int v = 0)
+    {
+    }
+
+    friend dastrie::itail& operator>>(dastrie::itail& is, empty_type& obj)
+    {
+        return is;
+    }
+
+    friend dastrie::otail& operator<<(dastrie::otail& os, const empty_type& obj)
+    {
+        return os;
+    }
+};
+
+/**
+ * A record of the empty type stores nothing; a leaf with an empty key
+ * postfix needs no TAIL at all.
+ */
+template <>
+struct inline_value_traits<empty_type>
+{
+    enum { available = 1 };
+
+    inline static bool encode(const empty_type& /*value*/, uint32_t& code)
+    {
+        code = 0;
+        return true;
+    }
+
+    inline static void decode(uint32_t /*code*/, empty_type& /*value*/)
+    {
+    }
+};
+
+
+
+/**
+ * Double Array Trie replicated on NUMA nodes (read-only).
+ *
+ *  On a host with multiple NUMA nodes (e.g., a multi-socket server), a
+ *  thread reading a trie allocated on a remote node pays the cross-node
+ *  latency for every access to the double array and tail. This class keeps
+ *  a copy of the trie image on each node, and routes a lookup to the copy
+ *  (replica) on the node of the calling thread. A replica is placed on its
+ *  node by the first-touch policy of the operating system, i.e., the image
+ *  is copied by a thread running on the node. On platforms other than
+ *  Linux, every thread is assumed to run on the node #0.
+ *
+ *  Create replicas by replicate() or replicate_local() before threads start
+ *  lookups; a lookup does not modify the instance, and threads can look up
+ *  keys concurrently. A thread on a node without a replica reads the
+ *  original image.
+ *
+ *  @param  value_tmpl          A type that represents a record value.
+ *  @param  doublearray_traits  A class in which various properties of
+ *                              double-array elements are described.
+ */
+template <class value_tmpl, class doublearray_traits = doublearray5_traits>
+class numa_trie
+{
+public:
+    /// A type that represents a trie.
+    typedef trie<value_tmpl, doublearray_traits> trie_type;
+    /// A type that represents a record value.
+    typedef value_tmpl value_type;
+    /// A type that represents a size.
+    typedef typename trie_type::size_type size_type;
 
-            } else if (strncmp(chunk, "TAIL", 4) == 0) {
-                // "TAIL" chunk.
-                m_tail.assign(q, datasize);
+protected:
+    struct replica_type
+    {
+        char* block;
+        trie_type trie;
 
-            }
+        replica_type() : block(NULL)
+        {
+        }
 
-            p += size;
+        ~replica_type()
+        {
+            delete[] block;
         }
+    };
 
-        // Make sure that arrays are allocated successfully.
-        if (!m_da || !m_tail) {
-            return 0;
+    const char* m_image;
+    size_type m_size;
+    char* m_block;
+    trie_type m_master;
+    std::vector<replica_type*> m_replicas;
+    std::vector<int> m_cpu_node;
+
+public:
+    /**
+     * Constructs an instance.
+     */
+    numa_trie()
+        : m_image(NULL), m_size(0), m_block(NULL)
+    {
+        m_replicas.resize(count_nodes(), NULL);
+
+        // Build the mapping table from CPU numbers to node numbers.
+        for (int node = 0;node < num_nodes();++node) {
+            std::vector<int> cpus;
+            node_cpus(node, cpus);
+            for (size_t i = 0;i < cpus.size();++i) {
+                if ((int)m_cpu_node.size() <= cpus[i]) {
+                    m_cpu_node.resize(cpus[i]+1, 0);
+                }
+                m_cpu_node[cpus[i]] = node;
+            }
         }
+    }
 
-        return total_size;
+    /**
+     * Destructs an instance.
+     */
+    virtual ~numa_trie()
+    {
+        clear();
     }
 
     /**
-     * Read a double-array trie from an input stream.
+     * Assigns the original image of a double-array trie from a memory block.
+     *  The memory block must be alive while this instance is in use.
+     *  @param  block           The pointer to the memory block.
+     *  @param  size            The size, in bytes, of the memory block.
+     *  @return size_type       If successful, the size, in bytes, of the
+     *                          memory block used to read a double-array trie;
+     *                          otherwise zero.
+     */
+    size_type assign(const char *block, size_type size)
+    {
+        clear();
+        size_type used_size = m_master.assign(block, size);
+        if (used_size != 0) {
+            m_image = block;
+            m_size = used_size;
+        }
+        return used_size;
+    }
+
+    /**
+     * Reads the original image of a double-array trie from an input stream.
      *  @param  is              The input stream.
      *  @return size_type       The size of the double-array data.
      */
     size_type read(std::istream& is)
     {
-        char chunk[4];
+        char data[CHUNKSIZE];
         uint32_t total_size;
-        uint8_t data[CHUNKSIZE];
         std::istream::pos_type offset = is.tellg();
 
-        // Read CHUNKSIZE bytes.
-        is.read(reinterpret_cast<char*>(data), CHUNKSIZE);
-        if (is.fail()) {
-            is.seekg(offset, std::ios::beg);
-            return 0;
-        }
-
-        // Parse the data as a chunk.
-        read_chunk(data, chunk, total_size);
-
-        // Make sure that the data is a "SDAT" chunk.
-        if (std::strncmp(chunk, "SDAT", 4) != 0) {
+        // Read the size of the "SDAT" chunk.
+        is.read(data, CHUNKSIZE);
+        if (is.fail() || std::strncmp(data, "SDAT", 4) != 0) {
             is.seekg(offset, std::ios::beg);
             return 0;
         }
-
-        // Allocate a new memory block and copy the data.
-        m_block = new char[total_size];
-        std::memcpy(m_block, data, CHUNKSIZE);
-
-        // Read the actual data.
-        is.read(m_block + CHUNKSIZE, total_size - CHUNKSIZE);
-        if (is.fail()) {
+        std::memcpy(&total_size, data + 4, sizeof(total_size));
+        if (total_size < CHUNKSIZE) {
             is.seekg(offset, std::ios::beg);
             return 0;
         }
 
-        // Allocate the trie.
-        size_type used_size = assign(m_block, total_size);
-        if (used_size != total_size) {
+        // Read the entire chunk to a memory block.
+        char* block = new char[total_size];
+        std::memcpy(block, data, CHUNKSIZE);
+        is.read(block + CHUNKSIZE, total_size - CHUNKSIZE);
+        if (is.fail() || assign(block, total_size) != total_size) {
+            delete[] block;
             is.seekg(offset, std::ios::beg);
             return 0;
         }
 
-        return used_size;
+        m_block = block;
+        return total_size;
     }
 
-protected:
-    size_type read_uint32(const uint8_t* block, uint32_t& value)
+    /**
+     * Removes the image and replicas.
+     */
+    void clear()
     {
-        return read_data(block, &value, sizeof(value));
+        for (size_t i = 0;i < m_replicas.size();++i) {
+            delete m_replicas[i];
+            m_replicas[i] = NULL;
+        }
+        delete[] m_block;
+        m_block = NULL;
+        m_image = NULL;
+        m_size = 0;
     }
 
-    size_type read_data(const uint8_t* block, void *data, size_t size)
+    /**
+     * Creates replicas on all NUMA nodes.
+     *  On Linux, the calling thread migrates to the CPUs of each node in
+     *  turn, and copies the image to a memory block on the node. The CPU
+     *  affinity of the thread is restored afterwards.
+     *  @return int             The number of nodes having replicas.
+     */
+    int replicate()
     {
-        std::memcpy(data, block, size);
-        return size;
+        int n = 0;
+#if defined(__linux__)
+        cpu_set_t saved;
+        if (sched_getaffinity(0, sizeof(saved), &saved) == 0) {
+            for (int node = 0;node < num_nodes();++node) {
+                std::vector<int> cpus;
+                if (!node_cpus(node, cpus)) {
+                    continue;
+                }
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                for (size_t i = 0;i < cpus.size();++i) {
+                    CPU_SET(cpus[i], &set);
+                }
+                if (sched_setaffinity(0, sizeof(set), &set) == 0) {
+                    n += create(node) ? 1 : 0;
+                }
+            }
+            sched_setaffinity(0, sizeof(saved), &saved);
+            return n;
+        }
+#endif
+        return replicate_local() ? 1 : 0;
     }
 
-    size_type read_chunk(const uint8_t* block, char *chunk, uint32_t& size)
+    /**
+     * Creates a replica on the NUMA node of the calling thread.
+     *  @return bool            \c true if the node has a replica.
+     */
+    bool replicate_local()
     {
-        std::memcpy(chunk, block, 4);
-        read_uint32(block + 4, size);
-        return 8;
+        return create(current_node());
     }
-};
-
 
+    /**
+     * Obtains the trie for the NUMA node of the calling thread.
+     *  @return const trie_type&    The replica on the node of the calling
+     *                              thread if available; the trie of the
+     *                              original image otherwise.
+     */
+    const trie_type& local() const
+    {
+        int node = current_node();
+        if (0 <= node && node < num_nodes() && m_replicas[node] != NULL) {
+            return m_replicas[node]->trie;
+        }
+        return m_master;
+    }
 
-/**
- * A builder of a double-array trie.
- *
- *  This class builds a double-array trie from records sorted in dictionary
- *  order of keys.
- *
- *  @param  key_tmpl            A type that represents a record key. This type
- *                              must be either \c char* or \c std::string .
- *  @param  value_tmpl          A type that represents a record value.
- *  @param  doublearray_traits  A class in which various properties of
- *                              double-array elements are described.
- */
-template <
-    class key_tmpl,
-    class value_tmpl,
-    class doublearray_traits = doublearray5_traits
->
-class builder
-{
-public:
-    /// A type that represents a record.
-    typedef key_tmpl key_type;
-    /// A type that represents a record value.
-    typedef value_tmpl value_type;
-    /// A type that represents an element of a double array.
-    typedef typename doublearray_traits::element_type element_type;
-    /// A type that represents a base value in a double array.
-    typedef typename doublearray_traits::base_type base_type;
-    /// A type that represents a check value in a double array.
-    typedef typename doublearray_traits::check_type check_type;
-    /// A type that implements a double array.
-    typedef std::vector<element_type> doublearray_type;
-    /// A type of sizes.
-    typedef typename doublearray_type::size_type size_type;
+    /**
+     * Tests if the trie contains a key.
+     *  @param  key         The key string.
+     *  @return bool        \c true if the trie contains the key;
+     *                      \c false otherwise.
+     */
+    bool in(const char *key) const
+    {
+        return local().in(key);
+    }
 
     /**
-     * A type that represents a record (a pair of key and value).
+     * Finds a record.
+     *  @param  key         The key string.
+     *  @param[out] value   The reference to a variable that receives the
+     *                      value of the key.
+     *  @return bool        \c true if the trie contains the key;
+     *                      \c false otherwise.
      */
-    struct record_type
+    bool find(const char *key, value_type& value) const
     {
-        key_type key;       ///< The key of the record.
-        value_type value;   ///< The value of the record.
-    };
+        return local().find(key, value);
+    }
 
+    /**
+     * Gets the value for a key.
+     *  @param  key         The key string.
+     *  @param  def         The default value.
+     *  @return value_type  The value if the key exists in the trie,
+     *                      the default value (def) otherwise.
+     */
+    value_type get(const char *key, const value_type& def) const
+    {
+        return local().get(key, def);
+    }
 
     /**
-     * Exception class.
+     * Gets the number of NUMA nodes.
+     *  @return int             The number of nodes.
      */
-    class exception : public std::runtime_error
+    int num_nodes() const
     {
-    public:
-        /**
-         * Constructs an instance.
-         *  @param  msg     The error message.
-         */
-        explicit exception(const std::string& msg)
-            : std::runtime_error(msg)
-        {
-        }
-    };
+        return (int)m_replicas.size();
+    }
 
     /**
-     * Statistics of the double array trie.
+     * Reports the size of memory used by the replica on a NUMA node.
+     *  @param  node            The node number.
+     *  @return size_type       The size, in bytes, of the replica on the
+     *                          node; zero if the node has no replica.
      */
-    struct stat_type
+    size_type node_bytes(int node) const
     {
-        /// The size, in bytes, of the double array.
-        size_type   da_size;
-        /// The number of elements in the double array.
-        size_type   da_num_total;
-        /// The number of elements used actually in the double array.
-        size_type   da_num_used;
-        /// The number of nodes (excluding leaves).
-        size_type   da_num_nodes;
-        /// The number of leaves.
-        size_type   da_num_leaves;
-        /// The utilization ratio of the double array.
-        double      da_usage;
-        /// The size, in bytes, of the tail array.
-        size_type   tail_size;
-        /// The sum of the number of trials for finding bases.
-        size_type   bt_sum_base_trials;
-        /// The average number of trials for finding bases.
-        double      bt_avg_base_trials;
-    };
+        if (0 <= node && node < num_nodes() && m_replicas[node] != NULL) {
+            return m_size;
+        }
+        return 0;
+    }
 
     /**
-     * The type of a progress callback function.
-     *  @param  instance    The pointer to a user-defined instance.
-     *  @param  i           The number of records that have already been
-     *                      stored in the trie.
-     *  @param  n           The total number of records to be stored.
+     * Obtains the NUMA node of the calling thread.
+     *  @return int             The node number.
      */
-    typedef void (*callback_type)(void *instance, size_type i, size_type n);
+    int current_node() const
+    {
+#if defined(__linux__)
+        // sched_getcpu() is served by vDSO without a system call.
+        int cpu = sched_getcpu();
+        if (0 <= cpu && cpu < (int)m_cpu_node.size()) {
+            return m_cpu_node[cpu];
+        }
+#endif
+        return 0;
+    }
 
 protected:
-    struct dlink_element_type
+    bool create(int node)
     {
-        size_type prev;
-        size_type next;
-        dlink_element_type() : prev(0), next(0)
-        {
+        if (node < 0 || num_nodes() <= node || m_image == NULL) {
+            return false;
         }
-    };
-    typedef std::vector<dlink_element_type> dlink_type;
 
-    typedef std::vector<bool> baseusage_type;
+        if (m_replicas[node] == NULL) {
+            // The calling thread touches the memory block first.
+            replica_type* rep = new replica_type;
+            rep->block = new char[m_size];
+            std::memcpy(rep->block, m_image, m_size);
+            if (rep->trie.assign(rep->block, m_size) != m_size) {
+                delete rep;
+                return false;
+            }
+            m_replicas[node] = rep;
+        }
+        return true;
+    }
 
-    void* m_instance;
-    callback_type m_callback;
+    static int count_nodes()
+    {
+        // The file lists the range of node numbers, e.g., "0-1".
+        std::ifstream ifs("/sys/devices/system/node/possible");
+        std::string line;
+        if (ifs.fail() || !std::getline(ifs, line) || line.empty()) {
+            return 1;
+        }
+        size_t pos = line.find_last_of("-,");
+        int last = std::atoi(line.c_str() + (pos == std::string::npos ? 0 : pos + 1));
+        return (0 <= last) ? last + 1 : 1;
+    }
 
-    size_type m_i;
-    size_type m_n;
+    static bool node_cpus(int node, std::vector<int>& cpus)
+    {
+        // The file lists the ranges of CPU numbers, e.g., "0-3,8-11".
+        std::stringstream ss;
+        ss << "/sys/devices/system/node/node" << node << "/cpulist";
+        std::ifstream ifs(ss.str().c_str());
+        std::string line;
+        if (ifs.fail() || !std::getline(ifs, line)) {
+            return false;
+        }
 
-    doublearray_type m_da;
-    otail m_tail;
-    uint8_t m_table[NUMCHARS];
+        const char *p = line.c_str();
+        while (*p) {
+            char *q = NULL;
+            long first = std::strtol(p, &q, 10);
+            if (q == p) {
+                break;
+            }
+            long last = first;
+            if (*q == '-') {
+                p = q + 1;
+                last = std::strtol(p, &q, 10);
+            }
+            for (long i = first;i <= last;++i) {
+                cpus.push_back((int)i);
+            }
+            p = (*q == ',') ? q + 1 : q;
+        }
+        return !cpus.empty();
+    }
+};
 
-    baseusage_type m_used_bases;
-    dlink_type m_elink;
 
-    stat_type m_stat;
+
+/**
+ * Double Array Trie that records queries to a trace (read-only).
+ *
+ *  This class forwards look-ups to a trie, and writes the operation, the
+ *  time, and the query bytes of each look-up to an output stream, so that
+ *  the access pattern of an application can be replayed offline (e.g., by
+ *  the dastrie-replay utility) against other databases and formats. A trace
+ *  starts with the magic "DAQT", followed by the records of look-ups:
+ *
+ *  - the time elapsed from the previous record (or from the construction
+ *    for the first record) in nanoseconds, in a variable-length integer;
+ *  - the operation (TRACE_IN, TRACE_FIND, or TRACE_PREFIX) in a byte;
+ *  - the length of the query in a variable-length integer;
+ *  - the query bytes.
+ *
+ *  A variable-length integer stores 7 bits per byte, lower bits first; the
+ *  most significant bit of a byte indicates that a byte follows. When
+ *  compiled as C++11, threads can look up keys concurrently; otherwise,
+ *  look-ups through an instance must be serialized.
+ *
+ *  @param  value_tmpl          A type that represents a record value.
+ *  @param  doublearray_traits  A class in which various properties of
+ *                              double-array elements are described.
+ */
+template <class value_tmpl, class doublearray_traits = doublearray5_traits>
+class recorder
+{
+public:
+    /// A type that represents a trie.
+    typedef trie<value_tmpl, doublearray_traits> trie_type;
+    /// A type that represents a record value.
+    typedef value_tmpl value_type;
+    /// A type that represents a size.
+    typedef typename trie_type::size_type size_type;
+    /// A type that represents a prefix cursor.
+    typedef typename trie_type::prefix_cursor prefix_cursor;
+
+protected:
+    trie_type* m_trie;
+    std::ostream* m_os;
+    mutable uint64_t m_last;
+    mutable size_type m_n;
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && 1900 <= _MSC_VER)
+    mutable std::mutex m_mutex;
+#endif
 
 public:
     /**
-     * Constructs a builder.
+     * Constructs an instance and writes the header of a trace.
+     *  @param  trie        The pointer to the trie to look up.
+     *  @param  os          The pointer to the output stream receiving the
+     *                      trace; the stream must be opened in the binary
+     *                      mode.
      */
-    builder()
-        : m_instance(NULL), m_callback(NULL)
+    recorder(trie_type* trie, std::ostream* os)
+        : m_trie(trie), m_os(os), m_last(now()), m_n(0)
     {
+        m_os->write("DAQT", 4);
     }
 
     /**
-     * Destructs the builder.
+     * Destructs an instance.
      */
-    virtual ~builder()
+    virtual ~recorder()
     {
+        m_os->flush();
     }
 
     /**
-     * Sets a progress callback.
-     *  @param  instance    The pointer to a user-defined instance.
-     *  @param  callback    The callback function.
+     * Tests if the trie contains a key.
+     *  @param  key         The key string.
+     *  @return bool        \c true if the trie contains the key;
+     *                      \c false otherwise.
      */
-    void set_callback(void* instance, callback_type callback)
+    bool in(const char *key) const
     {
-        m_instance = instance;
-        m_callback = callback;
+        record(TRACE_IN, key, std::strlen(key));
+        return m_trie->in(key);
     }
 
     /**
-     * Builds a double-array trie from sorted records.
-     *  @param  first       The pointer addressing the first record.
-     *  @param  last        The pointer addressing the position one past the
-     *                      final record.
+     * Tests if the trie contains a key of a length.
+     *  @param  key         The pointer to the key bytes.
+     *  @param  length      The length of the key in bytes.
+     *  @return bool        \c true if the trie contains the key;
+     *                      \c false otherwise.
      */
-    void build(const record_type* first, const record_type* last)
+    bool in(const char *key, size_type length) const
     {
-        clear();
-
-        m_i = 0;
-        m_n = (size_t)(last - first);
-        build_table(m_table, first, last);
-
-        // Create the initial node.
-        da_expand(INITIAL_INDEX+1);
-        vlist_expand(INITIAL_INDEX+1);
-        set_base(INITIAL_INDEX, 1);
-        vlist_use(INITIAL_INDEX);
-        set_base(INITIAL_INDEX, arrange(0, first, last));
-
-        // 
-        compute_stat();
+        record(TRACE_IN, key, length);
+        return m_trie->in(key, length);
     }
 
     /**
-     * Initializes the double array.
+     * Finds a record.
+     *  @param  key         The key string.
+     *  @param[out] value   The reference to a variable that receives the
+     *                      value of the key.
+     *  @return bool        \c true if the trie contains the key;
+     *                      \c false otherwise.
      */
-    void clear()
+    bool find(const char *key, value_type& value) const
     {
-        // Initialize the character table.
-        for (int i = 0;i < NUMCHARS;++i) {
-            m_table[i] = i;
-        }
-
-        // Initialize the double array.
-        m_da.clear();
-        da_expand(1);
-
-        // Initialize the tail array.
-        m_tail.clear();
-        m_tail.write<uint8_t>(0);
+        record(TRACE_FIND, key, std::strlen(key));
+        return m_trie->find(key, value);
+    }
 
-        // Initialize the vacant linked list.
-        vlist_init();
+    /**
+     * Finds a record of a key of a length.
+     *  @param  key         The pointer to the key bytes.
+     *  @param  length      The length of the key in bytes.
+     *  @param[out] value   The reference to a variable that receives the
+     *                      value of the key.
+     *  @return bool        \c true if the trie contains the key;
+     *                      \c false otherwise.
+     */
+    bool find(const char *key, size_type length, value_type& value) const
+    {
+        record(TRACE_FIND, key, length);
+        return m_trie->find(key, length, value);
+    }
 
-        // Initialize the statistics.
-        std::memset(&m_stat, 0, sizeof(m_stat));
+    /**
+     * Gets the value for a key.
+     *  @param  key         The key string.
+     *  @param  def         The default value.
+     *  @return value_type  The value if the key exists in the trie,
+     *                      the default value (def) otherwise.
+     */
+    value_type get(const char *key, const value_type& def) const
+    {
+        record(TRACE_FIND, key, std::strlen(key));
+        return m_trie->get(key, def);
     }
 
     /**
-     * Obtains a read-only access to the double-array.
-     *  @return const doublearray_type& The reference to the double array.
+     * Retrieves records that are prefixes of a query.
+     *  @param  key         The query string.
+     *  @return prefix_cursor   The cursor for the prefixes.
      */
-    const doublearray_type& doublearray() const
+    prefix_cursor prefix(const char *key)
     {
-        return m_da;
+        record(TRACE_PREFIX, key, std::strlen(key));
+        return m_trie->prefix(key);
     }
 
     /**
-     * Obtains a read-only access to the tail array.
-     *  @return const otail&    The reference to the tail array.
+     * Retrieves records that are prefixes of a query of a length.
+     *  @param  key         The pointer to the query bytes.
+     *  @param  length      The length of the query in bytes.
+     *  @return prefix_cursor   The cursor for the prefixes.
      */
-    const otail& tail() const
+    prefix_cursor prefix(const char *key, size_type length)
     {
-        return m_tail;
+        record(TRACE_PREFIX, key, length);
+        return m_trie->prefix(key, length);
     }
 
     /**
-     * Obtains a read-only access to the character table.
-     *  @return const uint8_t*  The pointer to the character table.
+     * Gets the number of look-ups recorded.
+     *  @return size_type   The number of records in the trace.
      */
-    const uint8_t* table() const
+    size_type size() const
     {
-        return m_table;
+        return m_n;
     }
 
-    const stat_type& stat() const
+    /**
+     * Reads the clock for the timestamps of a trace.
+     *  @return uint64_t    The time in nanoseconds from an arbitrary epoch;
+     *                      the resolution is a microsecond on platforms
+     *                      without C++11 and gettimeofday().
+     */
+    static uint64_t now()
     {
-        return m_stat;
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && 1900 <= _MSC_VER)
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#elif defined(__unix__) || defined(__APPLE__)
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        return (uint64_t)tv.tv_sec * 1000000000 + (uint64_t)tv.tv_usec * 1000;
+#else
+        return (uint64_t)std::clock() * (1000000000 / CLOCKS_PER_SEC);
+#endif
     }
 
 protected:
-    base_type arrange(size_type p, const record_type* first, const record_type* last)
+    void record(int op, const char *key, size_type length) const
     {
-        size_type i;
-        const record_type* it;
-        const uint8_t* table = m_table;
-
-        // If the given range [first, last) points to a single record, i.e.,
-        // (first + 1 == last), store the key postfix and value of the record
-        // to the TAIL array; let the current node as a leaf node addressing
-        // to the offset from which (*first) are stored in the TAIL array.
-        if (first + 1 == last) {
-            const record_type& rec = *first;
-            size_t offset = m_tail.tellp();
-            if ((size_t)doublearray_traits::max_base() < offset) {
-                throw exception("The double array has no space to store leaves");
-            }
-            m_tail.write_string(rec.key, p);
-            m_tail << rec.value;
-
-            if (m_callback != NULL) {
-                m_callback(m_instance, ++m_i, m_n);
-            }
-            ++m_stat.da_num_leaves;
-            return -(base_type)offset;
-        }
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && 1900 <= _MSC_VER)
+        std::lock_guard<std::mutex> lock(m_mutex);
+#endif
+        uint64_t t = now();
+        write_varint(m_last < t ? t - m_last : 0);
+        m_os->put((char)op);
+        write_varint(length);
+        m_os->write(key, length);
+        m_last = t;
+        ++m_n;
+    }
 
-        // Build a list of child nodes of the current node, and obtain the
-        // range of records that each child node owns. Child nodes consist
-        // of a set of characters at records[i].key[p] for i in [begin, end).
-        int pc = -1;
-        struct child_t {
-            uint8_t             c;
-            size_type           offset;
-            const record_type*  first;
-            const record_type*  last;
-        } children[NUMCHARS];
-        size_type num_children = 0;
-        size_type max_offset = 0;
-        for (it = first;it != last;++it) {
-            int c = (int)(uint8_t)it->key[p];
-            if (pc < c) {
-                if (0 < num_children) {
-                    children[num_children-1].last = it;
-                }
-                size_type offset = (size_type)table[c] + 1;
-                children[num_children].first = it;
-                children[num_children].c = (uint8_t)c;
-                children[num_children].offset = offset;
-                if (max_offset < offset) {
-                    max_offset = offset;
-                }
-                ++num_children;
-            } else if (c < pc) {
-                throw exception("The records are not sorted in dictionary order of keys");
-            }
-            pc = c;
+    void write_varint(uint64_t v) const
+    {
+        while (0x80 <= v) {
+            m_os->put((char)((v & 0x7F) | 0x80));
+            v >>= 7;
         }
-        children[num_children-1].last = it;
-
-        // Find the minimum of the base address (base) that can store every
-        // child. This step would be very time consuming if we tried base
-        // indexes from 1 one by one and tested the vacanies for child nodes.
-        // Instead, we try to determine the index number of the first child-
-        // node by using a double-linked list of vacant nodes, and calculate
-        // back the base address from the index number of the child node.
-        size_type base = 0, index = 0;
-        for (;;) {
-            ++m_stat.bt_sum_base_trials;
-
-            // Obtain the index value of a next vacant node.
-            index = vlist_next(index);
-
-            // A base value must be greater than 1.
-            if (index < INITIAL_INDEX + children[0].offset) {
-                // The index is too small for a base value; try next.
-                continue;
-            }
-
-            // Calculate back the base value from the index.
-            base = index - children[0].offset;
+        m_os->put((char)v);
+    }
+};
 
-            // A base value must not be used by other places.
-            if (base < m_used_bases.size() && m_used_bases[base]) {
-                continue;
-            }
 
-            // Expand the double array and vacant list if necessary.
-            da_expand(base + max_offset + 1);
-            vlist_expand(base + max_offset + 1);
 
-            // Check if the base address can store every child in the list.
-            for (i = 1;i < num_children;++i) {
-                size_type offset = children[i].offset;
-                if (da_in_use(base + offset)) {
-                    break;
-                }
-            }
+/**
+ * Reader of a query trace written by dastrie::recorder.
+ */
+class trace_reader
+{
+protected:
+    std::istream* m_is;
+    uint64_t m_time;
 
-            // Exit the loop if successful.
-            if (i == num_children) {
-                break;
-            }
+public:
+    /**
+     * Constructs an instance and reads the header of a trace.
+     *  @param  is          The pointer to the input stream of the trace.
+     */
+    trace_reader(std::istream* is) : m_is(is), m_time(0)
+    {
+        char magic[4];
+        m_is->read(magic, 4);
+        if (m_is->fail() || std::strncmp(magic, "DAQT", 4) != 0) {
+            m_is = NULL;
         }
+    }
 
-        // Fail if the double array could not store the child nodes.
-        if ((size_type)doublearray_traits::max_base() <= base + max_offset) {
-            throw exception("The double array has no space to store child nodes");
-        }
+    /**
+     * Checks whether the stream starts with the header of a trace.
+     *  @return bool        \c true if the stream is a trace.
+     */
+    inline operator bool() const
+    {
+        return (m_is != NULL);
+    }
 
-        // Register the usage of the base address.
-        if (m_used_bases.size() <= base) {
-            m_used_bases.resize(base+1, false);
+    /**
+     * Reads the next record in the trace.
+     *  @param[out] time    The time of the look-up in nanoseconds from the
+     *                      beginning of the trace.
+     *  @param[out] op      The operation (TRACE_IN, TRACE_FIND, or
+     *                      TRACE_PREFIX).
+     *  @param[out] key     The query bytes.
+     *  @return bool        \c true if a record is read; \c false at the
+     *                      end of the trace or for a truncated record.
+     */
+    bool next(uint64_t& time, int& op, std::string& key)
+    {
+        uint64_t delta, length;
+        if (m_is == NULL || !read_varint(delta)) {
+            return false;
         }
-        m_used_bases[base] = true;
-
-        // Reserve the double-array elements for the child nodes by filling
-        // BASE = 1 tentatively. This step protects these elements from being
-        // used by the descendant nodes; this function recursively builds the
-        // double array in depth-first fashion.
-        for (i = 0;i < num_children;++i) {
-            size_type offset = children[i].offset;
-            set_base(base + offset, 1);
-            vlist_use(base + offset);
+        int c = m_is->get();
+        if (c == std::istream::traits_type::eof() || !read_varint(length)) {
+            return false;
         }
-
-        // Set BASE and CHECK values of each child node.
-            for (i = 0;i < num_children;++i) {
-            const child_t& child = children[i];
-            size_type offset = child.offset;
-            if (child.c != 0) {
-                // Set the base value of a child node by recursively arranging
-                // the descendant nodes.
-                set_base(base + offset, arrange(p+1, child.first, child.last));
-            } else {
-                if (child.first + 1 != child.last) {
-                    throw exception("Duplicated keys detected");
-                }
-                // Force to insert '\0' in the TAIL.
-                set_base(base + offset, arrange(p, child.first, child.last));
+        key.resize((size_t)length);
+        if (0 < length) {
+            m_is->read(&key[0], (std::streamsize)length);
+            if (m_is->fail()) {
+                return false;
             }
-            set_check(base + offset, (uint8_t)(offset - 1));
         }
-
-        ++m_stat.da_num_nodes;
-        return (base_type)base;
+        m_time += delta;
+        time = m_time;
+        op = c;
+        return true;
     }
 
-    void compute_stat()
+protected:
+    bool read_varint(uint64_t& value)
     {
-        m_stat.da_size = sizeof(m_da[0]) * m_da.size();
-        m_stat.da_num_total = m_da.size();
-        for (size_type i = 0;i < m_da.size();++i) {
-            if (da_in_use(i)) {
-                ++m_stat.da_num_used;
+        value = 0;
+        for (int shift = 0;shift < 64;shift += 7) {
+            int c = m_is->get();
+            if (c == std::istream::traits_type::eof()) {
+                return false;
+            }
+            value |= (uint64_t)(c & 0x7F) << shift;
+            if (!(c & 0x80)) {
+                return true;
             }
         }
-        m_stat.da_usage = m_stat.da_num_used / (double)m_stat.da_num_total;
-        m_stat.tail_size = m_tail.bytes();
-        m_stat.bt_avg_base_trials = m_stat.bt_sum_base_trials / (double)m_stat.da_num_total;
+        return false;
     }
+};
+
+
+
+/**
+ * A container of named tries (read-only).
+ *
+ *  A container file packs the images of many tries, which may store
+ *  different types of values and elements, with a directory of their names.
+ *  Map (or read) the file once, and obtain a trie by its name; the trie is
+ *  assigned to the image in the container without a copy, and is valid
+ *  while the container is alive. A container is a "DACT" chunk consisting
+ *  of a "DIRC" chunk and the images ("SDAT" chunks):
+ *
+ *  - "DACT" chunk: the size of the container;
+ *  - "DIRC" chunk: the number of tries, and for each trie, the offset and
+ *    size of the image, the length of the name, and the name padded to a
+ *    multiple of four bytes;
+ *  - the images, each of which starts at an offset aligned to
+ *    container::ALIGNMENT bytes.
+ */
+class container
+{
+public:
+    /// A type that represents a size.
+    typedef size_t size_type;
+
+    /// The alignment, in bytes, of the images in a container.
+    enum { ALIGNMENT = 64 };
+
+    /**
+     * An entry of the directory.
+     */
+    struct entry_type
+    {
+        /// The name of the trie.
+        std::string name;
+        /// The offset, in bytes, of the image from the start of the container.
+        size_type offset;
+        /// The size, in bytes, of the image.
+        size_type size;
+    };
 
 protected:
-    inline base_type get_base(size_type i) const
+    typedef std::vector<entry_type> entries_type;
+
+    const char* m_image;
+    size_type m_size;
+    char* m_block;
+    void* m_map;
+    size_type m_map_size;
+    entries_type m_entries;
+
+public:
+    /**
+     * Constructs an instance.
+     */
+    container()
+        : m_image(NULL), m_size(0), m_block(NULL), m_map(NULL), m_map_size(0)
     {
-        return doublearray_traits::get_base(m_da[i]);
     }
 
-    inline check_type get_check(size_type i) const
+    /**
+     * Destructs an instance.
+     */
+    virtual ~container()
     {
-        return doublearray_traits::get_check(m_da[i]);
+        clear();
     }
 
-    inline void set_base(size_type i, base_type v)
+    /**
+     * Assigns a container from a memory block.
+     *  The memory block must be alive while this instance and the tries
+     *  obtained from it are in use.
+     *  @param  block           The pointer to the memory block.
+     *  @param  size            The size, in bytes, of the memory block.
+     *  @return size_type       If successful, the size, in bytes, of the
+     *                          container; otherwise zero.
+     */
+    size_type assign(const char *block, size_type size)
     {
-        doublearray_traits::set_base(m_da[i], v);
+        clear();
+        if (!parse(block, size)) {
+            m_entries.clear();
+            return 0;
+        }
+        uint32_t total_size;
+        std::memcpy(&total_size, block + 4, sizeof(total_size));
+        m_image = block;
+        m_size = total_size;
+        return m_size;
     }
 
-    inline void set_check(size_type i, check_type v)
+    /**
+     * Reads a container from an input stream to a memory block owned by
+     * this instance.
+     *  @param  is              The input stream.
+     *  @return size_type       If successful, the size, in bytes, of the
+     *                          container; otherwise zero.
+     */
+    size_type read(std::istream& is)
     {
-        doublearray_traits::set_check(m_da[i], v);
+        char data[CHUNKSIZE];
+        uint32_t total_size;
+        std::istream::pos_type offset = is.tellg();
+
+        // Read the size of the "DACT" chunk.
+        is.read(data, CHUNKSIZE);
+        if (is.fail() || std::strncmp(data, "DACT", 4) != 0) {
+            is.seekg(offset, std::ios::beg);
+            return 0;
+        }
+        std::memcpy(&total_size, data + 4, sizeof(total_size));
+        if (total_size < CHUNKSIZE) {
+            is.seekg(offset, std::ios::beg);
+            return 0;
+        }
+
+        // Read the entire chunk to a memory block.
+        char* block = new char[total_size];
+        std::memcpy(block, data, CHUNKSIZE);
+        is.read(block + CHUNKSIZE, total_size - CHUNKSIZE);
+        if (is.fail() || assign(block, total_size) != total_size) {
+            delete[] block;
+            is.seekg(offset, std::ios::beg);
+            return 0;
+        }
+
+        m_block = block;
+        return total_size;
     }
 
-    inline bool da_in_use(size_type i) const
+    /**
+     * Maps a container file to the memory.
+     *  The file is mapped by mmap() on POSIX platforms, so that processes
+     *  sharing the file share its pages in the page cache; on the other
+     *  platforms, the file is read by read().
+     *  @param  filename        The name of the container file.
+     *  @return size_type       If successful, the size, in bytes, of the
+     *                          container; otherwise zero.
+     */
+    size_type map(const char *filename)
     {
-        return (i < m_da.size() && get_base(i) != 0);
+        clear();
+#if defined(__unix__) || defined(__APPLE__)
+        int fd = open(filename, O_RDONLY);
+        if (fd < 0) {
+            return 0;
+        }
+        struct stat st;
+        void* p = MAP_FAILED;
+        if (fstat(fd, &st) == 0 && 0 < st.st_size) {
+            p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        }
+        close(fd);
+        if (p == MAP_FAILED) {
+            return 0;
+        }
+        if (assign((const char*)p, (size_type)st.st_size) == 0) {
+            munmap(p, (size_t)st.st_size);
+            return 0;
+        }
+        m_map = p;
+        m_map_size = (size_type)st.st_size;
+        return m_size;
+#else
+        std::ifstream ifs(filename, std::ios::binary);
+        return read(ifs);
+#endif
     }
 
-    inline void da_expand(size_type size)
+    /**
+     * Releases the container.
+     *  The tries obtained from the container must not be used afterwards.
+     */
+    void clear()
     {
-        if (m_da.size() < size) {
-            m_da.resize(size, doublearray_traits::default_value());
+#if defined(__unix__) || defined(__APPLE__)
+        if (m_map != NULL) {
+            munmap(m_map, m_map_size);
         }
+#endif
+        m_map = NULL;
+        m_map_size = 0;
+        delete[] m_block;
+        m_block = NULL;
+        m_image = NULL;
+        m_size = 0;
+        m_entries.clear();
     }
 
-    void vlist_init()
+    /**
+     * Gets the number of tries in the container.
+     *  @return size_type       The number of tries.
+     */
+    size_type size() const
     {
-        m_elink.resize(1);
-        m_elink[0].next = 1;
-        m_elink[0].prev = 0;
+        return m_entries.size();
     }
 
-    inline size_type vlist_next(size_type i)
+    /**
+     * Obtains an entry of the directory.
+     *  @param  i               The index of the entry.
+     *  @return const entry_type&   The entry.
+     */
+    const entry_type& entry(size_type i) const
     {
-        return (i < m_elink.size()) ? m_elink[i].next : i+1;
+        return m_entries[i];
     }
 
-    void vlist_expand(size_type size)
+    /**
+     * Finds an entry of the directory by a name.
+     *  @param  name            The name of a trie.
+     *  @return const entry_type*   The pointer to the entry, or \c NULL if
+     *                              the container has no trie of the name.
+     */
+    const entry_type* find(const std::string& name) const
     {
-        if (m_elink.size() < size) {
-            size_type first = m_elink.size();
-            m_elink.resize(size);
-
-            size_type back = m_elink[0].prev;
-            for (size_type i = first;i < m_elink.size();++i) {
-                m_elink[i].prev = back;
-                m_elink[i].next = i+1;
-                back = i;
+        for (size_type i = 0;i < m_entries.size();++i) {
+            if (m_entries[i].name == name) {
+                return &m_entries[i];
             }
-            m_elink[0].prev = m_elink.size()-1;
         }
+        return NULL;
     }
 
-    void vlist_use(size_type i)
+    /**
+     * Obtains the image of a trie.
+     *  @param  name            The name of a trie.
+     *  @param[out] size        The size, in bytes, of the image.
+     *  @return const char*     The pointer to the image, or \c NULL if the
+     *                          container has no trie of the name.
+     */
+    const char* image(const std::string& name, size_type& size) const
     {
-        size_type prev = m_elink[i].prev;
-        size_type next = m_elink[i].next;
-        if (m_elink.size() <= next) {
-            m_elink.resize(next+1);
-            m_elink[next].next = next+1;
-            m_elink[0].prev = next; // The rightmost vacant node.
+        const entry_type* e = find(name);
+        if (e == NULL) {
+            size = 0;
+            return NULL;
         }
-        m_elink[prev].next = next;
-        m_elink[next].prev = prev;
+        size = e->size;
+        return m_image + e->offset;
     }
 
-protected:
-    struct unigram_freq
-    {
-        int c;          ///< Character code.
-        double freq;    ///< Frequency.
-    };
-
-    static bool comp_freq(const unigram_freq& x, const unigram_freq& y)
+    /**
+     * Assigns a trie to its image in the container without a copy.
+     *  @param  name            The name of a trie.
+     *  @param[out] trie        The trie; its type must agree with the value
+     *                          and element types of the image.
+     *  @return bool            \c true if successful; \c false if the
+     *                          container has no trie of the name, or the
+     *                          image has a different element type.
+     */
+    template <class trie_type>
+    bool get(const std::string& name, trie_type& trie) const
     {
-        return x.freq > y.freq;
+        size_type size;
+        const char* block = image(name, size);
+        return (block != NULL && trie.assign(block, size) == size);
     }
 
-    void build_table(
-        uint8_t *table,
-        const record_type* first,
-        const record_type* last
-        )
+protected:
+    bool parse(const char *block, size_type size)
     {
-        unigram_freq st[NUMCHARS];
-
-        // Initialize the frequency table.
-        for (int i = 0;i < NUMCHARS;++i) {
-            st[i].c = i;
-            st[i].freq = 0.;
+        uint32_t total_size, dir_size, n;
+        if (size < CHUNKSIZE * 2 + sizeof(uint32_t) ||
+            std::strncmp(block, "DACT", 4) != 0) {
+            return false;
         }
-
-        // Count the frequency of occurrences of characters.
-        for (const record_type* it = first;it != last;++it) {
-            for (int i = 0;it->key[i];++i) {
-                int c = (int)(uint8_t)it->key[i];
-                ++st[c].freq;
-            }
-            ++st[0].freq;
+        std::memcpy(&total_size, block + 4, sizeof(total_size));
+        if (size < total_size || std::strncmp(block + CHUNKSIZE, "DIRC", 4) != 0) {
+            return false;
+        }
+        std::memcpy(&dir_size, block + CHUNKSIZE + 4, sizeof(dir_size));
+        if (total_size < CHUNKSIZE + dir_size) {
+            return false;
         }
 
-        // Sort the frequency table.
-        std::sort(&st[0], &st[NUMCHARS], comp_freq);
-
-        // 
-        for (int i = 0;i < NUMCHARS;++i) {
-            table[st[i].c] = (uint8_t)i;
+        // Read the entries of the directory.
+        const char* p = block + CHUNKSIZE * 2;
+        const char* last = block + CHUNKSIZE + dir_size;
+        std::memcpy(&n, p, sizeof(n));
+        p += sizeof(n);
+        for (uint32_t i = 0;i < n;++i) {
+            uint32_t values[3];
+            if (last < p + sizeof(values)) {
+                return false;
+            }
+            std::memcpy(values, p, sizeof(values));
+            p += sizeof(values);
+            if (last < p + values[2] || total_size < values[0] ||
+                total_size - values[0] < values[1]) {
+                return false;
+            }
+            entry_type e;
+            e.offset = values[0];
+            e.size = values[1];
+            e.name.assign(p, values[2]);
+            m_entries.push_back(e);
+            p += (values[2] + 3) / 4 * 4;
         }
+        return true;
     }
+};
+
 
 
+/**
+ * A writer of a container of named tries.
+ *
+ *  Add the images of tries (e.g., the output of builder::write() or the
+ *  content of a database file) with their names, and write the container
+ *  that dastrie::container reads.
+ */
+class packer
+{
 public:
+    /// A type that represents a size.
+    typedef size_t size_type;
+
     /**
-     * Writes out the double-array trie to an output stream.
-     *  @param  os      The output stream.
+     * Exception class.
      */
-    void write(std::ostream& os)
+    class exception : public std::runtime_error
     {
-        // Calculate the size of each chunk.
-        size_type sda_size = CHUNKSIZE + sizeof(m_da[0]) * m_da.size();
-        size_type tblu_size = CHUNKSIZE + sizeof(uint8_t) * NUMCHARS;
-        size_type tail_size = CHUNKSIZE +  m_tail.bytes();
-        size_type total_size = SDAT_CHUNKSIZE + tblu_size + sda_size + tail_size;
-
-        // Write a "SDAT" chunk.
-        write_chunk(os, "SDAT", total_size);
-        write_uint32(os, (uint32_t)SDAT_CHUNKSIZE);
-        write_uint32(os, (uint32_t)m_n);
-
-        // Write a "TBLU" chunk.
-        write_chunk(os, "TBLU", tblu_size);
-        write_data(os, m_table, tblu_size - CHUNKSIZE);
+    public:
+        /**
+         * Constructs an instance.
+         *  @param  msg     The error message.
+         */
+        explicit exception(const std::string& msg)
+            : std::runtime_error(msg)
+        {
+        }
+    };
 
-        // Write a chunk for the double array.
-        write_chunk(os, doublearray_traits::chunk_id(), sda_size);
-        write_data(os, &m_da[0], sda_size - CHUNKSIZE);
+protected:
+    typedef std::pair<std::string, std::string> item_type;
+    std::vector<item_type> m_items;
 
-        // Write a chunk for the tail array.
-        write_chunk(os, "TAIL", tail_size);
-        write_data(os, m_tail.block(), tail_size - CHUNKSIZE);
+public:
+    /**
+     * Adds the image of a trie.
+     *  @param  name            The name of the trie.
+     *  @param  block           The pointer to the image ("SDAT" chunk).
+     *  @param  size            The size, in bytes, of the image.
+     *  @throws exception       The name is already used, or the block is
+     *                          not an image of a trie.
+     */
+    void add(const std::string& name, const char *block, size_type size)
+    {
+        for (size_type i = 0;i < m_items.size();++i) {
+            if (m_items[i].first == name) {
+                throw exception("Duplicated name: " + name);
+            }
+        }
+        if (probe(block, size) == 0) {
+            throw exception("Not an image of a trie: " + name);
+        }
+        uint32_t total_size;
+        std::memcpy(&total_size, block + 4, sizeof(total_size));
+        m_items.push_back(item_type(name, std::string(block, total_size)));
     }
 
-protected:
-    void write_uint32(std::ostream& os, uint32_t value)
+    /**
+     * Gets the number of tries added.
+     *  @return size_type       The number of tries.
+     */
+    size_type size() const
     {
-        write_data(os, &value, sizeof(value));
+        return m_items.size();
     }
 
-    void write_data(std::ostream& os, const void *data, size_t size)
+    /**
+     * Writes the container to an output stream.
+     *  @param  os              The output stream opened in the binary mode.
+     *  @throws exception       The container exceeds 4 GB.
+     */
+    void write(std::ostream& os) const
     {
-        os.write(reinterpret_cast<const char*>(data), size);
+        // Compute the size of the directory.
+        uint64_t dir_size = CHUNKSIZE + sizeof(uint32_t);
+        for (size_type i = 0;i < m_items.size();++i) {
+            dir_size += sizeof(uint32_t) * 3 + (m_items[i].first.length() + 3) / 4 * 4;
+        }
+
+        // Compute the offsets of the images.
+        std::vector<uint64_t> offsets;
+        uint64_t offset = CHUNKSIZE + dir_size;
+        for (size_type i = 0;i < m_items.size();++i) {
+            offset = align(offset);
+            offsets.push_back(offset);
+            offset += m_items[i].second.length();
+        }
+        if (0xFFFFFFFF < offset) {
+            throw exception("The container exceeds 4 GB");
+        }
+
+        // Write the "DACT" and "DIRC" chunks.
+        write_chunk(os, "DACT", (uint32_t)offset);
+        write_chunk(os, "DIRC", (uint32_t)dir_size);
+        write_uint32(os, (uint32_t)m_items.size());
+        for (size_type i = 0;i < m_items.size();++i) {
+            const std::string& name = m_items[i].first;
+            write_uint32(os, (uint32_t)offsets[i]);
+            write_uint32(os, (uint32_t)m_items[i].second.length());
+            write_uint32(os, (uint32_t)name.length());
+            os.write(name.data(), name.length());
+            write_padding(os, (name.length() + 3) / 4 * 4 - name.length());
+        }
+
+        // Write the images.
+        uint64_t pos = CHUNKSIZE + dir_size;
+        for (size_type i = 0;i < m_items.size();++i) {
+            write_padding(os, (size_type)(offsets[i] - pos));
+            os.write(m_items[i].second.data(), m_items[i].second.length());
+            pos = offsets[i] + m_items[i].second.length();
+        }
     }
 
-    void write_chunk(std::ostream& os, const char *chunk, size_type size)
+protected:
+    static uint64_t align(uint64_t offset)
     {
-        os.write(chunk, 4);
-        write_uint32(os, (uint32_t)size);
+        return (offset + container::ALIGNMENT - 1) /
+            container::ALIGNMENT * container::ALIGNMENT;
     }
-};
 
-/**
- * Empty type.
- *  Specify this class as a value type of dastrie::trie and dastrie::builder
- *  to make these class behave as a set (e.g., std::set) rather than a map.
- */
-struct empty_type
-{
-    empty_type(int v = 0)
+    static void write_uint32(std::ostream& os, uint32_t value)
     {
+        os.write(reinterpret_cast<const char*>(&value), sizeof(value));
     }
 
-    friend dastrie::itail& operator>>(dastrie::itail& is, empty_type& obj)
+    static void write_chunk(std::ostream& os, const char *chunk, uint32_t size)
     {
-        return is;
+        os.write(chunk, 4);
+        write_uint32(os, size);
     }
 
-    friend dastrie::otail& operator<<(dastrie::otail& os, const empty_type& obj)
+    static void write_padding(std::ostream& os, size_type n)
     {
-        return os;
+        for (size_type i = 0;i < n;++i) {
+            os.put(0);
+        }
     }
 };
 
@@ -1926,6 +5933,46 @@ bytes (compact).
 </tr>
 </table>
 
+@subsection performance_synthetic Synthetic key sets
+
+The corpora above cannot be redistributed. The key generator (dastrie-gen)
+produces key sets of similar shapes (English-like words, URLs, CJK strings,
+random binary keys, n-grams, and file paths) and query streams with a given
+hit ratio and skew; the output depends only on the options (e.g., the seed),
+so that experiments can be reproduced anywhere:
+@code
+$ dastrie-gen -s urls -n 1000000 -S 1 -o urls.txt -q queries.txt -r 0.9 -z 1.0
+$ dastrie-build -d urls.db urls.txt
+$ dastrie-test -d urls.db -L in queries.txt
+@endcode
+
+@subsection performance_baseline Baselines
+
+The benchmark utility (dastrie-bench) runs identical build and look-up
+workloads against std::map, std::unordered_map (C++11), a sorted std::vector,
+and tries with 4-byte, 5-byte, and 8-byte elements, and reports the build
+time, the time per exact-match and prefix look-up, and the memory per key in a
+table:
+@code
+$ dastrie-bench -q queries.txt urls.txt
+@endcode
+
+@subsection performance_replay Replaying query traces
+
+Wrap a trie with dastrie::recorder in an application to capture a trace of
+the queries and their timing, e.g.,
+@code
+std::ofstream trace("queries.trc", std::ios::binary);
+dastrie::recorder<int> rec(&trie, &trace);
+rec.find(key, value);
+@endcode
+The replay utility (dastrie-replay) issues the queries in a trace against a
+database with N threads, at the recorded rate (-s 1), a scaled rate, or as
+fast as possible (-s 0), and reports the throughput and latency percentiles:
+@code
+$ dastrie-replay -t int -n 4 -s 2 -d other.db queries.trc
+@endcode
+
 @section acknowledgements Acknowledgements
 The data structure of the (static) double-array trie is described in:
 - Jun-ichi Aoe. An efficient digital search algorithm by using a double-array structure. <i>IEEE Transactions on Software Engineering</i>, Vol. 15, No. 9, pp. 1066-1077, 1989.
@@ -2036,7 +6083,10 @@ choose 4 bytes per element and save 1 byte per element if your data is small
 enough to be stored with no longer than 0x007FFFFF elements (<i>note that the
 number of elements is different from the number of records</i>). Specify
 dastrie::doublearray4_traits at the third argument for implementing a double
-array with 4 bytes per element.
+array with 4 bytes per element. Conversely, dastrie::doublearray8_traits spends
+8 bytes per element to keep the first three bytes of the key postfix in each
+leaf, so that a look-up whose query differs from the postfix within these
+bytes is rejected without reading the tail array.
 
 @section tutorial_builder Building a trie
 
@@ -2073,6 +6123,14 @@ If necessary, set a callback function by using dastrie::builder::set_callback()
 to receive progress reports in building a trie. Refer to build.cpp for an
 actual usage.
 
+When the value type is dastrie::empty_type or an integer type, call
+dastrie::builder::set_inline_values() so that a leaf whose key ends at the
+leaf stores the value in the element itself; looking up such a key reads
+nothing from the tail array.
+@code
+builder.set_inline_values(true);
+@endcode
+
 Call dastrie::builder::build to build a trie from records. The first argument
 is the iterator (pointer) addressing to the first record, and the second
 argument is the iterator (pointer) addressing one past the final record.
@@ -2117,11 +6175,30 @@ Alternatively, you can read a trie structure from a memory block by using the
 dastrie::trie::assign() function. This function may be useful when you would
 like to use mmap() API for reading a trie.
 
+An application using many tries can pack them into a container file with
+names (dastrie::packer or the dastrie-pack utility), map the file once by
+dastrie::container::map(), and obtain each trie by its name without a copy.
+@code
+dastrie::container cont;
+cont.map("dictionaries.dact");
+trie_type trie;
+cont.get("words", trie);
+@endcode
+
 Now you are ready to access the trie. Please refer to the
 @ref sample "sample code" for
 retrieving a record (dastrie::trie::get() and dastrie::trie::find()),
 checking the existence of a record (dastrie::trie::in()),
 and retrieving records that are prefixes of keys (dastrie::trie::prefix()).
+
+The number of keys that start with a prefix (e.g., for ranking completions)
+is obtained by dastrie::trie::count_prefix(). This function reads the number
+at the node reached by the prefix if the trie was built with
+dastrie::builder::set_counts() (4 bytes per element), and counts the keys in
+the subtree of the node otherwise.
+@code
+size_t n = trie.count_prefix("app");
+@endcode
 */
 
 #endif/*__DASTRIE_H__*/
@@ -0,0 +1,207 @@
+/*
+ *      A tool to pack double-array tries into a container.
+ *
+ * Copyright (c) 2008, Naoaki Okazaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Northwestern University, University of Tokyo,
+ *       nor the names of its contributors may be used to endorse or promote
+ *       products derived from this software without specific prior written
+ *       permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* $Id$ */
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <dastrie.h>
+#include <optparse.h>
+
+class option : public optparse
+{
+public:
+    std::string output;
+    std::string list;
+    bool help;
+
+public:
+    option() : help(false)
+    {
+    }
+
+    BEGIN_OPTION_MAP_INLINE()
+        ON_OPTION_WITH_ARG(SHORTOPT('o') || LONGOPT("output"))
+            output = arg;
+
+        ON_OPTION_WITH_ARG(SHORTOPT('l') || LONGOPT("list"))
+            list = arg;
+
+        ON_OPTION(SHORTOPT('h') || LONGOPT("help"))
+            help = true;
+
+    END_OPTION_MAP()
+};
+
+static void usage(std::ostream& os, const char *argv0)
+{
+    os << "USAGE: " << argv0 << " [OPTIONS] NAME=DB [NAME=DB ...]" << std::endl;
+    os << "This utility packs database files (DB) built by dastrie-build into a container" << std::endl;
+    os << "file in which each trie is identified by its NAME." << std::endl;
+    os << std::endl;
+    os << "OPTIONS:" << std::endl;
+    os << "  -o, --output=FILE  write the container to FILE" << std::endl;
+    os << "  -l, --list=FILE    list the tries in the container FILE and exit" << std::endl;
+    os << "  -h, --help         show this help message and exit" << std::endl;
+    os << std::endl;
+    os << "Use dastrie-search -n NAME -d FILE to search a trie in a container." << std::endl;
+}
+
+static char* read_file(const char *filename, std::streamoff& size)
+{
+    std::ifstream ifs(filename, std::ios::binary);
+    if (ifs.fail()) {
+        return NULL;
+    }
+
+    ifs.seekg(0, std::ios::end);
+    size = ifs.tellg();
+    ifs.seekg(0, std::ios::beg);
+
+    char *block = new char[(size_t)size];
+    ifs.read(block, size);
+    if (ifs.fail()) {
+        delete[] block;
+        return NULL;
+    }
+    return block;
+}
+
+static int list(std::ostream& os, const option& opt)
+{
+    dastrie::container cont;
+    if (cont.map(opt.list.c_str()) == 0) {
+        std::cerr << "ERROR: Failed to read the container: " << opt.list << std::endl;
+        return 1;
+    }
+
+    os << "Number of tries: " << cont.size() << std::endl;
+    for (size_t i = 0;i < cont.size();++i) {
+        const dastrie::container::entry_type& e = cont.entry(i);
+        size_t size;
+        const char* block = cont.image(e.name, size);
+        os << e.name << '\t' << e.offset << '\t' << e.size << '\t' <<
+            "SDA" << dastrie::probe(block, size) << std::endl;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    option opt;
+    int ret = 0;
+    int arg_used = 0;
+    std::ostream& es = std::cerr;
+    std::ostream& os = std::cout;
+
+    // Show the copyright information.
+    es << "DASTrie pack ";
+    es << DASTRIE_MAJOR_VERSION << "." << DASTRIE_MINOR_VERSION << " ";
+    es << DASTRIE_COPYRIGHT << std::endl;
+    es << std::endl;
+
+    // Parse the command-line options.
+    try {
+        arg_used = opt.parse(argv, argc);
+    } catch (const optparse::unrecognized_option& e) {
+        es << "ERROR: unrecognized option: " << e.what() << std::endl;
+        return 1;
+    } catch (const optparse::invalid_value& e) {
+        es << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+
+    // Show the help message and exit.
+    if (opt.help) {
+        usage(os, argv[0]);
+        return ret;
+    }
+
+    // List the tries in a container.
+    if (!opt.list.empty()) {
+        return list(os, opt);
+    }
+
+    if (opt.output.empty()) {
+        es << "ERROR: No output file specified." << std::endl;
+        return 1;
+    }
+    if (argc <= arg_used) {
+        es << "ERROR: No database file specified." << std::endl;
+        return 1;
+    }
+
+    // Add the database files.
+    dastrie::packer packer;
+    for (int i = arg_used;i < argc;++i) {
+        std::string arg = argv[i];
+        std::string::size_type eq = arg.find('=');
+        if (eq == std::string::npos || eq == 0) {
+            es << "ERROR: The argument must be NAME=DB: " << arg << std::endl;
+            return 1;
+        }
+        std::string name = arg.substr(0, eq);
+        std::string db = arg.substr(eq + 1);
+
+        std::streamoff size;
+        char *block = read_file(db.c_str(), size);
+        if (block == NULL) {
+            es << "ERROR: Failed to read the database: " << db << std::endl;
+            return 1;
+        }
+        try {
+            packer.add(name, block, (size_t)size);
+        } catch (const dastrie::packer::exception& e) {
+            delete[] block;
+            es << "ERROR: " << e.what() << std::endl;
+            return 1;
+        }
+        delete[] block;
+        os << "Added: " << name << " (" << size << " bytes)" << std::endl;
+    }
+
+    // Write the container.
+    std::ofstream ofs(opt.output.c_str(), std::ios::binary);
+    if (ofs.fail()) {
+        es << "ERROR: Failed to open the output file: " << opt.output << std::endl;
+        return 1;
+    }
+    try {
+        packer.write(ofs);
+    } catch (const dastrie::packer::exception& e) {
+        es << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+    os << "Number of tries: " << packer.size() << std::endl;
+    return 0;
+}
@@ -0,0 +1,530 @@
+/*
+ *      A tool to replay query traces against a double-array trie.
+ *
+ * Copyright (c) 2008, Naoaki Okazaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Northwestern University, University of Tokyo,
+ *       nor the names of its contributors may be used to endorse or promote
+ *       products derived from this software without specific prior written
+ *       permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* $Id$ */
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <dastrie.h>
+#include <optparse.h>
+#include <histogram.h>
+
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && 1900 <= _MSC_VER)
+#define DASTRIE_REPLAY_THREADS
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#endif
+
+class option : public optparse
+{
+public:
+    enum {
+        TYPE_EMPTY,
+        TYPE_INT,
+        TYPE_DOUBLE,
+        TYPE_STRING,
+    };
+
+    int type;
+    bool compact;
+    bool wide;
+    std::string db;
+    int threads;
+    double speed;
+    bool help;
+
+public:
+    option() : type(TYPE_EMPTY), compact(false), wide(false), threads(1), speed(1.), help(false)
+    {
+    }
+
+    BEGIN_OPTION_MAP_INLINE()
+        ON_OPTION_WITH_ARG(SHORTOPT('t') || LONGOPT("type"))
+            if (strcmp(arg, "empty") == 0) {
+                type = TYPE_EMPTY;
+            } else if (strcmp(arg, "int") == 0) {
+                type = TYPE_INT;
+            } else if (strcmp(arg, "double") == 0) {
+                type = TYPE_DOUBLE;
+            } else if (strcmp(arg, "string") == 0) {
+                type = TYPE_STRING;
+            } else {
+                std::stringstream ss;
+                ss << "unknown record type specified: " << arg;
+                throw invalid_value(ss.str());
+            }
+
+        ON_OPTION(SHORTOPT('c') || LONGOPT("compact"))
+            compact = true;
+
+        ON_OPTION(SHORTOPT('w') || LONGOPT("wide"))
+            wide = true;
+
+        ON_OPTION_WITH_ARG(SHORTOPT('d') || LONGOPT("db"))
+            db = arg;
+
+        ON_OPTION_WITH_ARG(SHORTOPT('n') || LONGOPT("threads"))
+            threads = std::atoi(arg);
+            if (threads <= 0) {
+                std::stringstream ss;
+                ss << "the number of threads must be positive: " << arg;
+                throw invalid_value(ss.str());
+            }
+
+        ON_OPTION_WITH_ARG(SHORTOPT('s') || LONGOPT("speed"))
+            speed = std::atof(arg);
+            if (speed < 0) {
+                std::stringstream ss;
+                ss << "the speed must not be negative: " << arg;
+                throw invalid_value(ss.str());
+            }
+
+        ON_OPTION(SHORTOPT('h') || LONGOPT("help"))
+            help = true;
+
+    END_OPTION_MAP()
+};
+
+static void usage(std::ostream& os, const char *argv0)
+{
+    os << "USAGE: " << argv0 << " [OPTIONS] TRACE" << std::endl;
+    os << "This utility replays a query trace (TRACE) recorded by dastrie::recorder against" << std::endl;
+    os << "a double-array trie, and reports the throughput and latency percentiles." << std::endl;
+    os << std::endl;
+    os << "OPTIONS:" << std::endl;
+    os << "  -t, --type=TYPE    specify a type of record values:" << std::endl;
+    os << "      empty              no values [DEFAULT]" << std::endl;
+    os << "      int                integer values" << std::endl;
+    os << "      double             floating-point values" << std::endl;
+    os << "      string             string values" << std::endl;
+    os << "  -c, --compact      read a double array trie whose element is stored in 4 bytes;" << std::endl;
+    os << "                     this is detected from the database file unless it fails" << std::endl;
+    os << "  -w, --wide         read a double array trie whose element is stored in 8 bytes;" << std::endl;
+    os << "                     this is detected from the database file unless it fails" << std::endl;
+    os << "  -d, --db           specify a database file against which queries are replayed" << std::endl;
+    os << "  -n, --threads=N    replay the queries with N threads; the query #i is issued" << std::endl;
+    os << "                     by the thread #(i % N) [DEFAULT: 1]" << std::endl;
+    os << "  -s, --speed=X      issue the queries X times as fast as recorded; 0 issues each" << std::endl;
+    os << "                     query as soon as the previous one completes [DEFAULT: 1]" << std::endl;
+    os << "  -h, --help         show this help message and exit" << std::endl;
+    os << std::endl;
+    os << "The latency of a query is measured from the time at which the query is" << std::endl;
+    os << "scheduled, including the time waiting for preceding queries in the thread." << std::endl;
+}
+
+/**
+ * A query in a trace.
+ */
+struct event
+{
+    uint64_t time;
+    int op;
+    std::string key;
+};
+
+static bool read_trace(const char *filename, std::vector<event>& events)
+{
+    std::ifstream ifs(filename, std::ios::binary);
+    if (ifs.fail()) {
+        return false;
+    }
+    dastrie::trace_reader tr(&ifs);
+    if (!tr) {
+        return false;
+    }
+
+    event e;
+    while (tr.next(e.time, e.op, e.key)) {
+        events.push_back(e);
+    }
+    return true;
+}
+
+#if defined(DASTRIE_REPLAY_THREADS)
+
+typedef std::chrono::steady_clock clock_type;
+
+static const char *operations[] = {"in", "find", "prefix"};
+enum { NUM_OPERATIONS = 3 };
+
+template <class trie_type>
+static bool lookup(trie_type& trie, const event& e)
+{
+    bool binary = trie.binary();
+    switch (e.op) {
+    case dastrie::TRACE_IN:
+        return binary ? trie.in(e.key.data(), e.key.length()) : trie.in(e.key.c_str());
+    case dastrie::TRACE_FIND:
+        {
+            typename trie_type::value_type value;
+            return binary ?
+                trie.find(e.key.data(), e.key.length(), value) :
+                trie.find(e.key.c_str(), value);
+        }
+    default:
+        {
+            bool found = false;
+            typename trie_type::prefix_cursor pfx = binary ?
+                trie.prefix(e.key.data(), e.key.length()) :
+                trie.prefix(e.key.c_str());
+            while (pfx.next()) {
+                found = true;
+            }
+            return found;
+        }
+    }
+}
+
+template <class trie_type>
+struct player
+{
+    trie_type* trie;
+    const std::vector<event>* events;
+    int thread;
+    int num_threads;
+    double speed;
+    std::atomic<int>* ready;
+    std::atomic<bool>* go;
+    const clock_type::time_point* start;
+    histogram latency[NUM_OPERATIONS];
+    size_t hits;
+
+    void operator()()
+    {
+        const std::vector<event>& v = *events;
+
+        // Wait until all threads are ready.
+        ++*ready;
+        while (!go->load()) {
+            std::this_thread::yield();
+        }
+
+        for (size_t i = thread;i < v.size();i += num_threads) {
+            const event& e = v[i];
+            clock_type::time_point begin;
+            if (0 < speed) {
+                // Wait for the time scaled from the trace.
+                begin = *start + std::chrono::nanoseconds((uint64_t)(e.time / speed));
+                // Sleep while the query is far ahead, since a sleep may
+                // overrun by hundreds of microseconds.
+                clock_type::time_point t = clock_type::now();
+                if (t + std::chrono::milliseconds(1) < begin) {
+                    std::this_thread::sleep_until(begin - std::chrono::microseconds(500));
+                }
+                while (clock_type::now() < begin) {
+                    // Spin for the rest, yielding to the other threads.
+                    std::this_thread::yield();
+                }
+            } else {
+                begin = clock_type::now();
+            }
+            if (lookup(*trie, e)) {
+                ++hits;
+            }
+            uint64_t ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                clock_type::now() - begin).count();
+            latency[(0 <= e.op && e.op < NUM_OPERATIONS) ? e.op : 0].record(ns);
+        }
+    }
+};
+
+static void output_histogram(std::ostream& os, const char *name, const histogram& h)
+{
+    os << name << ": " << h.count();
+    if (0 < h.count()) {
+        os << ", p50: " << h.percentile(50.);
+        os << ", p90: " << h.percentile(90.);
+        os << ", p99: " << h.percentile(99.);
+        os << ", p99.9: " << h.percentile(99.9);
+        os << ", max: " << h.max();
+    }
+    os << std::endl;
+}
+
+template <class trie_type>
+static int replay(
+    std::ostream& os,
+    trie_type& trie,
+    const std::vector<event>& events,
+    const option& opt
+    )
+{
+    int n = opt.threads;
+    std::atomic<int> ready(0);
+    std::atomic<bool> go(false);
+    clock_type::time_point start;
+    std::vector<player<trie_type> > players(n);
+    std::vector<std::thread> threads;
+    for (int t = 0;t < n;++t) {
+        player<trie_type>& p = players[t];
+        p.trie = &trie;
+        p.events = &events;
+        p.thread = t;
+        p.num_threads = n;
+        p.speed = opt.speed;
+        p.ready = &ready;
+        p.go = &go;
+        p.start = &start;
+        p.hits = 0;
+    }
+    for (int t = 0;t < n;++t) {
+        threads.push_back(std::thread(std::ref(players[t])));
+    }
+
+    // Measure the wall-clock time from the start to the last thread.
+    while (ready.load() < n) {
+        std::this_thread::yield();
+    }
+    start = clock_type::now();
+    go = true;
+    for (int t = 0;t < n;++t) {
+        threads[t].join();
+    }
+    double sec = std::chrono::duration<double>(clock_type::now() - start).count();
+
+    // Merge the results of the threads.
+    size_t hits = 0;
+    histogram all, latency[NUM_OPERATIONS];
+    for (int t = 0;t < n;++t) {
+        hits += players[t].hits;
+        for (int i = 0;i < NUM_OPERATIONS;++i) {
+            latency[i].merge(players[t].latency[i]);
+            all.merge(players[t].latency[i]);
+        }
+    }
+
+    os << "Threads: " << n << std::endl;
+    if (0 < opt.speed) {
+        os << "Speed: " << opt.speed << " times as fast as recorded" << std::endl;
+    } else {
+        os << "Speed: as fast as possible" << std::endl;
+    }
+    os << "Wall-clock time: " << sec << ", throughput: " <<
+        (events.size() / sec) << " queries/s" << std::endl;
+    os << "Hits: " << hits << std::endl;
+    os << "Latency (ns):" << std::endl;
+    for (int i = 0;i < NUM_OPERATIONS;++i) {
+        if (0 < latency[i].count()) {
+            std::string name = std::string("  ") + operations[i];
+            output_histogram(os, name.c_str(), latency[i]);
+        }
+    }
+    output_histogram(os, "  All", all);
+    return 0;
+}
+
+#else
+
+template <class trie_type>
+static int replay(
+    std::ostream& /*os*/,
+    trie_type& /*trie*/,
+    const std::vector<event>& /*events*/,
+    const option& /*opt*/
+    )
+{
+    std::cerr << "ERROR: Replaying a trace requires C++11." << std::endl;
+    return 1;
+}
+
+#endif/*DASTRIE_REPLAY_THREADS*/
+
+template <class value_type, class traits_type>
+int replay(const std::vector<event>& events, const option& opt)
+{
+    typedef dastrie::trie<value_type, traits_type> trie_type;
+    trie_type trie;
+    std::ostream& os = std::cout;
+    std::ostream& es = std::cerr;
+
+    if (opt.db.empty()) {
+        es << "ERROR: No database file specified." << std::endl;
+        return 1;
+    }
+
+    std::ifstream ifs(opt.db.c_str(), std::ios::binary);
+    if (ifs.fail()) {
+        es << "ERROR: Database file not found." << std::endl;
+        return 1;
+    }
+
+    if (trie.read(ifs) == 0) {
+        es << "ERROR: Failed to read the database." << std::endl;
+        return 1;
+    }
+
+    return replay(os, trie, events, opt);
+}
+
+int main(int argc, char *argv[])
+{
+    option opt;
+    int ret = 0;
+    int arg_used = 0;
+    std::ostream& es = std::cerr;
+    std::ostream& os = std::cout;
+
+    // Show the copyright information.
+    es << "DASTrie replay ";
+    es << DASTRIE_MAJOR_VERSION << "." << DASTRIE_MINOR_VERSION << " ";
+    es << DASTRIE_COPYRIGHT << std::endl;
+    es << std::endl;
+
+    // Parse the command-line options.
+    try {
+        arg_used = opt.parse(argv, argc);
+    } catch (const optparse::unrecognized_option& e) {
+        es << "ERROR: unrecognized option: " << e.what() << std::endl;
+        return 1;
+    } catch (const optparse::invalid_value& e) {
+        es << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+
+    // Show the help message and exit.
+    if (opt.help) {
+        usage(os, argv[0]);
+        return ret;
+    }
+
+    // Make sure that a trace file is specified.
+    if (argc <= arg_used) {
+        es << "ERROR: No trace file specified." << std::endl;
+        return 1;
+    }
+
+    // Read the trace.
+    std::vector<event> events;
+    if (!read_trace(argv[arg_used], events)) {
+        es << "ERROR: Failed to read the trace." << std::endl;
+        return 1;
+    }
+    os << "Number of queries: " << events.size() << std::endl;
+    if (!events.empty()) {
+        os << "Duration of the trace: " << events.back().time / 1e9 << std::endl;
+    }
+
+    // Identify the size of double-array elements from the database.
+    if (!opt.db.empty()) {
+        std::ifstream ifs(opt.db.c_str(), std::ios::binary);
+        int width = dastrie::probe(ifs);
+        if (width == 4) {
+            opt.compact = true;
+            opt.wide = false;
+        } else if (width == 5) {
+            opt.compact = false;
+            opt.wide = false;
+        } else if (width == 8) {
+            opt.compact = false;
+            opt.wide = true;
+        }
+    }
+
+    // Dispatch.
+    switch (opt.type) {
+    case option::TYPE_EMPTY:
+        if (opt.compact) {
+            return replay<
+                dastrie::empty_type,
+                dastrie::doublearray4_traits
+            >(events, opt);
+        } else if (opt.wide) {
+            return replay<
+                dastrie::empty_type,
+                dastrie::doublearray8_traits
+            >(events, opt);
+        } else {
+            return replay<
+                dastrie::empty_type,
+                dastrie::doublearray5_traits
+            >(events, opt);
+        }
+    case option::TYPE_INT:
+        if (opt.compact) {
+            return replay<
+                int,
+                dastrie::doublearray4_traits
+            >(events, opt);
+        } else if (opt.wide) {
+            return replay<
+                int,
+                dastrie::doublearray8_traits
+            >(events, opt);
+        } else {
+            return replay<
+                int,
+                dastrie::doublearray5_traits
+            >(events, opt);
+        }
+    case option::TYPE_DOUBLE:
+        if (opt.compact) {
+            return replay<
+                double,
+                dastrie::doublearray4_traits
+            >(events, opt);
+        } else if (opt.wide) {
+            return replay<
+                double,
+                dastrie::doublearray8_traits
+            >(events, opt);
+        } else {
+            return replay<
+                double,
+                dastrie::doublearray5_traits
+            >(events, opt);
+        }
+    case option::TYPE_STRING:
+        if (opt.compact) {
+            return replay<
+                char*,
+                dastrie::doublearray4_traits
+            >(events, opt);
+        } else if (opt.wide) {
+            return replay<
+                char*,
+                dastrie::doublearray8_traits
+            >(events, opt);
+        } else {
+            return replay<
+                char*,
+                dastrie::doublearray5_traits
+            >(events, opt);
+        }
+    }
+
+    return 0;
+}
@@ -49,7 +49,7 @@ int main(int argc, char *argv[])
     /*
       Note that, although this sample program uses a file, a trie class can
       also receive a double-array trie directly from a builder,
-        trie.assign(builder.doublearray(), builder.tail(), builder.table());
+        trie.assign(builder);
     */
 
     // Get the values of keys or the default value if the key does not exist.
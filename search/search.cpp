@@ -52,16 +52,22 @@ public:
         MODE_SEARCH,
         MODE_CHECK,
         MODE_PREFIX,
+        MODE_TOKENIZE,
+        MODE_COUNT,
         MODE_HELP,
     };
 
     int type;
     int mode;
     bool compact;
+    bool wide;
+    bool sorted;
+    bool verbose;
     std::string db;
+    std::string name;
 
 public:
-    option() : type(TYPE_EMPTY), mode(MODE_SEARCH), compact(false)
+    option() : type(TYPE_EMPTY), mode(MODE_SEARCH), compact(false), wide(false), sorted(false), verbose(false)
     {
     }
 
@@ -84,15 +90,33 @@ public:
         ON_OPTION(SHORTOPT('c') || LONGOPT("compact"))
             compact = true;
 
+        ON_OPTION(SHORTOPT('w') || LONGOPT("wide"))
+            wide = true;
+
         ON_OPTION_WITH_ARG(SHORTOPT('d') || LONGOPT("db"))
             db = arg;
 
+        ON_OPTION_WITH_ARG(SHORTOPT('n') || LONGOPT("name"))
+            name = arg;
+
         ON_OPTION(SHORTOPT('i') || LONGOPT("in"))
             mode = MODE_CHECK;
 
         ON_OPTION(SHORTOPT('p') || LONGOPT("prefix"))
             mode = MODE_PREFIX;
 
+        ON_OPTION(SHORTOPT('T') || LONGOPT("tokenize"))
+            mode = MODE_TOKENIZE;
+
+        ON_OPTION(SHORTOPT('k') || LONGOPT("count"))
+            mode = MODE_COUNT;
+
+        ON_OPTION(SHORTOPT('s') || LONGOPT("sorted"))
+            sorted = true;
+
+        ON_OPTION(SHORTOPT('v') || LONGOPT("verbose"))
+            verbose = true;
+
         ON_OPTION(SHORTOPT('h') || LONGOPT("help"))
             mode = MODE_HELP;
 
@@ -114,12 +138,24 @@ static void usage(std::ostream& os, const char *argv0)
     os << "      int                integer values" << std::endl;
     os << "      double             floating-point values" << std::endl;
     os << "      string             string values" << std::endl;
-    os << "  -c, --compact      make a double array trie compact by storing a double-array" << std::endl;
-    os << "                     element in 4 bytes; this compaction is available only when" << std::endl;
-    os << "                     the number of records are small" << std::endl;
+    os << "  -c, --compact      read a double array trie whose element is stored in 4 bytes;" << std::endl;
+    os << "                     this is detected from the database file unless it fails" << std::endl;
+    os << "  -w, --wide         read a double array trie whose element is stored in 8 bytes;" << std::endl;
+    os << "                     this is detected from the database file unless it fails" << std::endl;
     os << "  -d, --db           specify a database file to which the double array trie will" << std::endl;
     os << "                     be stored; by default, this utility write no database" << std::endl;
+    os << "  -n, --name=NAME    search the trie NAME in a container file (-d) made by" << std::endl;
+    os << "                     dastrie-pack; the container is mapped without a copy" << std::endl;
+    os << "  -T, --tokenize     split STDIN into the longest keys in the trie, and output" << std::endl;
+    os << "                     the offset, length, key, and value of each token" << std::endl;
+    os << "  -k, --count        output the number of keys that start with each query; this" << std::endl;
+    os << "                     is fast when the trie was built with the counts (-k)" << std::endl;
+    os << "  -s, --sorted       resume each look-up from the longest common prefix with the" << std::endl;
+    os << "                     previous query; this is faster for sorted queries" << std::endl;
+    os << "  -v, --verbose      report the memory used by the trie to STDERR" << std::endl;
     os << "  -h, --help         show this help message and exit" << std::endl;
+    os << std::endl;
+    os << "Queries to a trie of binary keys (built with -b) are hexadecimal strings." << std::endl;
 }
 
 inline static std::ostream& output_value(std::ostream& os, const dastrie::empty_type& value)
@@ -145,10 +181,151 @@ inline static std::ostream& output_value(std::ostream& os, const char* value)
     return os;
 }
 
+static int hex_digit(char c)
+{
+    if ('0' <= c && c <= '9') {
+        return c - '0';
+    } else if ('a' <= c && c <= 'f') {
+        return c - 'a' + 10;
+    } else if ('A' <= c && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static bool decode_hex(const std::string& str, std::string& bytes)
+{
+    bytes.clear();
+    for (size_t i = 0;i < str.length();i += 2) {
+        int hi = hex_digit(str[i]);
+        int lo = i + 1 < str.length() ? hex_digit(str[i+1]) : -1;
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        bytes += (char)(hi * 16 + lo);
+    }
+    return true;
+}
+
+static std::string encode_hex(const std::string& bytes)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string str;
+    for (size_t i = 0;i < bytes.length();++i) {
+        str += digits[(uint8_t)bytes[i] >> 4];
+        str += digits[(uint8_t)bytes[i] & 0x0F];
+    }
+    return str;
+}
+
+template <class value_type>
+class token_printer
+{
+protected:
+    std::ostream& m_os;
+    const std::string& m_text;
+
+public:
+    token_printer(std::ostream& os, const std::string& text)
+        : m_os(os), m_text(text)
+    {
+    }
+
+    static void callback(
+        void *instance,
+        size_t offset,
+        size_t length,
+        const value_type& value,
+        bool /*matched*/
+        )
+    {
+        token_printer* printer = reinterpret_cast<token_printer*>(instance);
+        std::ostream& os = printer->m_os;
+        os << offset << '\t' << length << '\t';
+        os << printer->m_text.substr(offset, length) << '\t';
+        output_value(os, value) << std::endl;
+    }
+};
+
+template <class trie_type, class value_type>
+static void tokenize(trie_type& trie, std::istream& is, std::ostream& os)
+{
+    char buffer[4096];
+    std::string text;
+    token_printer<value_type> printer(os, text);
+    typename trie_type::tokenizer tok(
+        &trie, &printer, printer.callback, trie_type::tokenizer::UNMATCHED_SKIP);
+
+    // Feed STDIN to the tokenizer in chunks.
+    while (!is.eof()) {
+        is.read(buffer, sizeof(buffer));
+        if (is.gcount() <= 0) {
+            break;
+        }
+        text.append(buffer, (size_t)is.gcount());
+        tok.feed(buffer, (size_t)is.gcount());
+    }
+    tok.finish();
+}
+
+template <class trie_type>
+static void search_binary(trie_type& trie, const option& opt, const std::string& line, std::ostream& os)
+{
+    std::string key;
+    if (!decode_hex(line, key)) {
+        std::cerr << "ERROR: Invalid hexadecimal key: " << line << std::endl;
+        return;
+    }
+
+    switch (opt.mode) {
+    case option::MODE_SEARCH:
+        {
+            typename trie_type::value_type value;
+            if (trie.find(key.data(), key.length(), value)) {
+                os << line << '\t';
+                output_value(os, value) << std::endl;
+            }
+        }
+        break;
+    case option::MODE_CHECK:
+        os << line << (trie.in(key.data(), key.length()) ? "\t1" : "\t0") << std::endl;
+        break;
+    case option::MODE_PREFIX:
+        {
+            typename trie_type::prefix_cursor pfx = trie.prefix(key.data(), key.length());
+            while (pfx.next()) {
+                os << encode_hex(pfx.query.substr(0, pfx.length)) << '\t';
+                output_value(os, pfx.value) << std::endl;
+            }
+        }
+        break;
+    case option::MODE_COUNT:
+        os << line << '\t' << trie.count_prefix(key.data(), key.length()) << std::endl;
+        break;
+    }
+}
+
+template <class trie_type>
+static void output_memory_usage(std::ostream& os, const trie_type& trie)
+{
+    typename trie_type::memory_usage_type mu = trie.memory_usage();
+    os << "Memory usage:" << std::endl;
+    os << "  Character tables: " << mu.table << " bytes" << std::endl;
+    os << "  Double array: " << mu.da << " bytes" << std::endl;
+    os << "  TAIL: " << mu.tail << " bytes" << std::endl;
+    os << "  Extras: " << mu.extras << " bytes" << std::endl;
+    os << "  Owned: " << mu.owned << " bytes" << std::endl;
+    os << "  Borrowed: " << mu.borrowed << " bytes" << std::endl;
+    os << "  Resident pages: " << mu.resident_pages << " / " << mu.pages;
+    os << " (" << mu.page_size << " bytes per page)" << std::endl;
+    os << std::endl;
+}
+
 template <class value_type, class traits_type>
 int search(const option& opt)
 {
     typedef dastrie::trie<value_type, traits_type> trie_type;
+    dastrie::container cont;
     trie_type trie;
     std::istream& is = std::cin;
     std::ostream& os = std::cout;
@@ -159,17 +336,40 @@ int search(const option& opt)
         return 1;
     }
 
-    std::ifstream ifs(opt.db.c_str(), std::ios::binary);
-    if (ifs.fail()) {
-        es << "ERROR: Database file not found." << std::endl;
-        return 1;
+    if (!opt.name.empty()) {
+        // Assign the trie to its image in the container.
+        if (cont.map(opt.db.c_str()) == 0) {
+            es << "ERROR: Failed to read the container." << std::endl;
+            return 1;
+        }
+        if (!cont.get(opt.name, trie)) {
+            es << "ERROR: Failed to read the trie in the container: " << opt.name << std::endl;
+            return 1;
+        }
+    } else {
+        std::ifstream ifs(opt.db.c_str(), std::ios::binary);
+        if (ifs.fail()) {
+            es << "ERROR: Database file not found." << std::endl;
+            return 1;
+        }
+
+        if (trie.read(ifs) == 0) {
+            es << "ERROR: Failed to read the database." << std::endl;
+            return 1;
+        }
     }
 
-    if (trie.read(ifs) == 0) {
-        es << "ERROR: Failed to read the database." << std::endl;
-        return 1;
+    if (opt.verbose) {
+        output_memory_usage(es, trie);
     }
 
+    if (opt.mode == option::MODE_TOKENIZE) {
+        tokenize<trie_type, value_type>(trie, is, os);
+        return 0;
+    }
+
+    typename trie_type::sorted_cursor sc = trie.sorted();
+
     for (;;) {
         std::string line;
         std::getline(is, line);
@@ -177,18 +377,27 @@ int search(const option& opt)
             break;
         }
 
+        // Queries for binary keys are written in hexadecimal.
+        if (trie.binary()) {
+            search_binary(trie, opt, line, os);
+            continue;
+        }
+
         switch (opt.mode) {
         case option::MODE_SEARCH:
             {
                 value_type value;
-                if (trie.find(line.c_str(), value)) {
+                bool found = opt.sorted ?
+                    sc.find(line.c_str(), value) :
+                    trie.find(line.c_str(), value);
+                if (found) {
                     os << line << '\t';
                     output_value(os, value) << std::endl;
                 }
             }
             break;
         case option::MODE_CHECK:
-            if (trie.in(line.c_str())) {
+            if (opt.sorted ? sc.in(line.c_str()) : trie.in(line.c_str())) {
                 os << line << "\t1" << std::endl;
             } else {
                 os << line << "\t0" << std::endl;
@@ -203,6 +412,9 @@ int search(const option& opt)
                 }
             }
             break;
+        case option::MODE_COUNT:
+            os << line << '\t' << trie.count_prefix(line.c_str()) << std::endl;
+            break;
         }
     }
 
@@ -240,6 +452,31 @@ int main(int argc, char *argv[])
         return ret;
     }
 
+    // Identify the size of double-array elements from the database.
+    if (!opt.db.empty()) {
+        int width = 0;
+        if (!opt.name.empty()) {
+            dastrie::container cont;
+            size_t size = 0;
+            const char *block = cont.map(opt.db.c_str()) ?
+                cont.image(opt.name, size) : NULL;
+            width = block != NULL ? dastrie::probe(block, size) : 0;
+        } else {
+            std::ifstream ifs(opt.db.c_str(), std::ios::binary);
+            width = dastrie::probe(ifs);
+        }
+        if (width == 4) {
+            opt.compact = true;
+            opt.wide = false;
+        } else if (width == 5) {
+            opt.compact = false;
+            opt.wide = false;
+        } else if (width == 8) {
+            opt.compact = false;
+            opt.wide = true;
+        }
+    }
+
     // Dispatch.
     switch (opt.type) {
     case option::TYPE_EMPTY:
@@ -248,6 +485,11 @@ int main(int argc, char *argv[])
                 dastrie::empty_type,
                 dastrie::doublearray4_traits
             >(opt);
+        } else if (opt.wide) {
+            return search<
+                dastrie::empty_type,
+                dastrie::doublearray8_traits
+            >(opt);
         } else {
             return search<
                 dastrie::empty_type,
@@ -260,6 +502,11 @@ int main(int argc, char *argv[])
                 int,
                 dastrie::doublearray4_traits
             >(opt);
+        } else if (opt.wide) {
+            return search<
+                int,
+                dastrie::doublearray8_traits
+            >(opt);
         } else {
             return search<
                 int,
@@ -272,6 +519,11 @@ int main(int argc, char *argv[])
                 double,
                 dastrie::doublearray4_traits
             >(opt);
+        } else if (opt.wide) {
+            return search<
+                double,
+                dastrie::doublearray8_traits
+            >(opt);
         } else {
             return search<
                 double,
@@ -284,6 +536,11 @@ int main(int argc, char *argv[])
                 char*,
                 dastrie::doublearray4_traits
             >(opt);
+        } else if (opt.wide) {
+            return search<
+                char*,
+                dastrie::doublearray8_traits
+            >(opt);
         } else {
             return search<
                 char*,
@@ -0,0 +1,152 @@
+/*
+ *      A regression test for assigning a trie from a builder.
+ *
+ * Copyright (c) 2008, Naoaki Okazaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Northwestern University, University of Tokyo,
+ *       nor the names of its contributors may be used to endorse or promote
+ *       products derived from this software without specific prior written
+ *       permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* $Id$ */
+
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <dastrie.h>
+
+typedef dastrie::builder<std::string, int> builder_type;
+typedef dastrie::trie<int> trie_type;
+
+/*
+ * Generates keys of bytes drawn from an alphabet (deterministically), and
+ * sorts them so that many keys are prefixes of others.
+ */
+static void generate(std::vector<std::string>& keys, const std::string& alphabet)
+{
+    unsigned int seed = 1;
+    for (int i = 0;i < 5000;++i) {
+        std::string key;
+        seed = seed * 1103515245 + 12345;
+        int length = 1 + (seed >> 16) % 6;
+        for (int j = 0;j < length;++j) {
+            seed = seed * 1103515245 + 12345;
+            key += alphabet[(seed >> 16) % alphabet.size()];
+        }
+        keys.push_back(key);
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+}
+
+/*
+ * Checks that a trie assigned from a builder answers the queries the same
+ * as the trie written by the builder and read back.
+ */
+static bool test(const char *name, builder_type& builder, const std::vector<std::string>& keys)
+{
+    std::vector<builder_type::record_type> records(keys.size());
+    for (size_t i = 0;i < keys.size();++i) {
+        records[i].key = keys[i];
+        records[i].value = (int)i;
+    }
+    builder.build(&records[0], &records[0] + records.size());
+
+    std::stringstream ss;
+    builder.write(ss);
+    trie_type expected;
+    if (expected.read(ss) == 0) {
+        std::cerr << "ERROR: " << name << ": failed to read the trie." << std::endl;
+        return false;
+    }
+    trie_type trie;
+    trie.assign(builder);
+
+    if (trie.binary() != expected.binary()) {
+        std::cerr << "ERROR: " << name << ": the binary modes differ." << std::endl;
+        return false;
+    }
+    if (trie.memory_usage().extras != expected.memory_usage().extras) {
+        std::cerr << "ERROR: " << name << ": the jump tables, terminal table, "
+            << "or numbers of keys differ." << std::endl;
+        return false;
+    }
+
+    // Query the keys, their prefixes, and their extensions.
+    for (size_t i = 0;i < keys.size();++i) {
+        const std::string& key = keys[i];
+        for (size_t n = 0;n <= key.size() + 1;++n) {
+            std::string query = key.substr(0, n);
+            if (key.size() < n) {
+                query += 'a';
+            }
+            int value = -1, value_expected = -1;
+            bool found = trie.find(query.c_str(), query.size(), value);
+            bool found_expected = expected.find(query.c_str(), query.size(), value_expected);
+            size_t count = trie.count_prefix(query.c_str(), query.size());
+            size_t count_expected = expected.count_prefix(query.c_str(), query.size());
+            if (found != found_expected || value != value_expected || count != count_expected) {
+                std::cerr << "ERROR: " << name << ": the query of length "
+                    << query.size() << " for the key #" << i
+                    << " is answered differently." << std::endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    // Binary keys that contain null characters.
+    std::vector<std::string> binary_keys;
+    generate(binary_keys, std::string("\0\1\2a", 4));
+    builder_type builder;
+    builder.set_binary(true);
+    if (!test("binary", builder, binary_keys)) {
+        return 1;
+    }
+
+    // Values stored in leaf elements.
+    std::vector<std::string> text_keys;
+    generate(text_keys, "abcd");
+    builder_type builder_inline;
+    builder_inline.set_inline_values(true);
+    if (!test("inline", builder_inline, text_keys)) {
+        return 1;
+    }
+
+    // Jump tables and the numbers of keys under internal nodes.
+    builder_type builder_tables;
+    builder_tables.set_jump(2);
+    builder_tables.set_counts(true);
+    if (!test("tables", builder_tables, text_keys)) {
+        return 1;
+    }
+
+    return 0;
+}
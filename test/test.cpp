@@ -35,20 +35,44 @@
 #include <iostream>
 #include <string>
 #include <sstream>
+#include <vector>
 #include <dastrie.h>
 #include <optparse.h>
+#include <histogram.h>
+#include <perfcounter.h>
 
 #include <time.h>
 
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && 1900 <= _MSC_VER)
+#define DASTRIE_TEST_THREADS
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#endif
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
 class option : public optparse
 {
 public:
     bool compact;
+    bool wide;
+    bool sorted;
+    bool numa;
     std::string db;
+    std::string warmup;
+    std::string profile;
+    std::string scale;
+    std::string latency;
+    double rate;
+    int rounds;
+    bool counters;
     bool help;
 
 public:
-    option() : compact(false), help(false)
+    option() : compact(false), wide(false), sorted(false), numa(false), rate(0), rounds(1), counters(false), help(false)
     {
     }
 
@@ -56,9 +80,69 @@ public:
         ON_OPTION(SHORTOPT('c') || LONGOPT("compact"))
             compact = true;
 
+        ON_OPTION(SHORTOPT('w') || LONGOPT("wide"))
+            wide = true;
+
         ON_OPTION_WITH_ARG(SHORTOPT('d') || LONGOPT("db"))
             db = arg;
 
+        ON_OPTION(SHORTOPT('s') || LONGOPT("sorted"))
+            sorted = true;
+
+        ON_OPTION(SHORTOPT('N') || LONGOPT("numa"))
+            numa = true;
+
+        ON_OPTION_WITH_ARG(SHORTOPT('W') || LONGOPT("warmup"))
+            if (strcmp(arg, "all") != 0 &&
+                strncmp(arg, "all:", 4) != 0 &&
+                strncmp(arg, "levels:", 7) != 0 &&
+                strncmp(arg, "profile:", 8) != 0) {
+                std::stringstream ss;
+                ss << "unknown warm-up strategy specified: " << arg;
+                throw invalid_value(ss.str());
+            }
+            warmup = arg;
+
+        ON_OPTION_WITH_ARG(SHORTOPT('P') || LONGOPT("save-profile"))
+            profile = arg;
+
+        ON_OPTION_WITH_ARG(SHORTOPT('S') || LONGOPT("scale"))
+            if (strcmp(arg, "shared") != 0 && strcmp(arg, "copy") != 0) {
+                std::stringstream ss;
+                ss << "unknown scaling mode specified: " << arg;
+                throw invalid_value(ss.str());
+            }
+            scale = arg;
+
+        ON_OPTION_WITH_ARG(SHORTOPT('L') || LONGOPT("latency"))
+            if (strcmp(arg, "in") != 0 &&
+                strcmp(arg, "find") != 0 &&
+                strcmp(arg, "prefix") != 0) {
+                std::stringstream ss;
+                ss << "unknown operation specified: " << arg;
+                throw invalid_value(ss.str());
+            }
+            latency = arg;
+
+        ON_OPTION_WITH_ARG(SHORTOPT('r') || LONGOPT("rate"))
+            rate = std::atof(arg);
+            if (rate <= 0) {
+                std::stringstream ss;
+                ss << "the rate must be positive: " << arg;
+                throw invalid_value(ss.str());
+            }
+
+        ON_OPTION_WITH_ARG(SHORTOPT('R') || LONGOPT("rounds"))
+            rounds = std::atoi(arg);
+            if (rounds <= 0) {
+                std::stringstream ss;
+                ss << "the number of rounds must be positive: " << arg;
+                throw invalid_value(ss.str());
+            }
+
+        ON_OPTION(SHORTOPT('C') || LONGOPT("counters"))
+            counters = true;
+
         ON_OPTION(SHORTOPT('h') || LONGOPT("help"))
             help = true;
 
@@ -75,14 +159,448 @@ static void usage(std::ostream& os, const char *argv0)
     os << "          character; the records must be sorted by dictionary order of keys." << std::endl;
     os << std::endl;
     os << "OPTIONS:" << std::endl;
-    os << "  -c, --compact      make a double array trie compact by storing a double-array" << std::endl;
-    os << "                     element in 4 bytes; this compaction is available only when" << std::endl;
-    os << "                     the number of records are small" << std::endl;
+    os << "  -c, --compact      read a double array trie whose element is stored in 4 bytes;" << std::endl;
+    os << "                     this is detected from the database file unless it fails" << std::endl;
+    os << "  -w, --wide         read a double array trie whose element is stored in 8 bytes;" << std::endl;
+    os << "                     this is detected from the database file unless it fails" << std::endl;
     os << "  -d, --db           specify a database file to which the double array trie will" << std::endl;
     os << "                     be stored; by default, this utility write no database" << std::endl;
+    os << "  -s, --sorted       look up the keys with a cursor that resumes each descent" << std::endl;
+    os << "                     from the longest common prefix with the previous key" << std::endl;
+    os << "  -N, --numa         replicate the trie on every NUMA node and look up the keys" << std::endl;
+    os << "                     in the replica on the node of the current thread" << std::endl;
+    os << "  -W, --warmup=WARM  fault in the trie before the look-ups:" << std::endl;
+    os << "      all[:N]            every page of the trie (with N threads)" << std::endl;
+    os << "      levels:K           the nodes in the top K levels of the trie" << std::endl;
+    os << "      profile:FILE       the pages listed in a profile FILE" << std::endl;
+    os << "  -P, --save-profile=FILE" << std::endl;
+    os << "                     write the pages resident after the look-ups to FILE" << std::endl;
+    os << "  -S, --scale=MODE   measure the wall-clock throughput of 1, 2, 4, ... threads up" << std::endl;
+    os << "                     to all cores, each pinned to a core and looking up the keys" << std::endl;
+    os << "                     in a shuffled order:" << std::endl;
+    os << "      shared             all threads share one trie" << std::endl;
+    os << "      copy               each thread reads its own copy of the trie" << std::endl;
+    os << "  -L, --latency=OP   measure the latency of every look-up, and report percentiles" << std::endl;
+    os << "                     of hits and misses separately; the lines of INPUT are used" << std::endl;
+    os << "                     as queries (which need not be in the trie) for OP:" << std::endl;
+    os << "      in                 trie::in()" << std::endl;
+    os << "      find               trie::find()" << std::endl;
+    os << "      prefix             all prefixes of a query by trie::prefix()" << std::endl;
+    os << "  -r, --rate=N       issue N look-ups per second with -L (open loop); latencies" << std::endl;
+    os << "                     are measured from the scheduled time of each look-up, so" << std::endl;
+    os << "                     that a stall delays the subsequent look-ups in the results" << std::endl;
+    os << "  -R, --rounds=N     look up the keys N times in each thread with -S, or in total" << std::endl;
+    os << "                     with -L [DEFAULT: 1]" << std::endl;
+    os << "  -C, --counters     count instructions, branch misses, L1D, LLC, and dTLB misses" << std::endl;
+    os << "                     per look-up with hardware performance counters (Linux) for" << std::endl;
+    os << "                     the keys in the input order, with a sorted cursor, and in a" << std::endl;
+    os << "                     shuffled order" << std::endl;
     os << "  -h, --help         show this help message and exit" << std::endl;
 }
 
+template <class trie_type>
+static void output_residency(std::ostream& os, const trie_type& trie, const char *when)
+{
+    size_t total = 0;
+    size_t resident = trie.resident_pages(total);
+    os << "Resident pages " << when << ": " << resident << "/" << total << std::endl;
+}
+
+template <class trie_type>
+static bool warmup(std::ostream& os, const trie_type& trie, const std::string& strategy)
+{
+    size_t n = 0;
+    clock_t start = clock();
+
+    if (strategy.compare(0, 3, "all") == 0) {
+        int num_threads = 1;
+        if (strategy.size() > 4) {
+            num_threads = std::atoi(strategy.c_str() + 4);
+        }
+        n = trie.warmup(num_threads);
+    } else if (strategy.compare(0, 7, "levels:") == 0) {
+        n = trie.warmup_levels(std::atoi(strategy.c_str() + 7));
+    } else if (strategy.compare(0, 8, "profile:") == 0) {
+        std::ifstream ifs(strategy.c_str() + 8, std::ios::binary);
+        if (ifs.fail()) {
+            return false;
+        }
+        n = trie.warmup_profile(ifs);
+    }
+
+    clock_t end = clock();
+    os << "Warm-up (" << strategy << "): " << n << " touched in " <<
+        (end - start) / (double)CLOCKS_PER_SEC << std::endl;
+    return true;
+}
+
+static void split_keys(char *p, std::vector<const char*>& keys)
+{
+    while (*p) {
+        char *next = std::strchr(p, '\n');
+        if (next != NULL) {
+            *next++ = 0;
+        } else {
+            next = p + std::strlen(p);
+        }
+        keys.push_back(p);
+        p = next;
+    }
+}
+
+static void shuffle_keys(std::vector<const char*>& keys)
+{
+    // Fisher-Yates shuffle with a fixed seed for repeatable runs.
+    uint32_t x = 2463534242U;
+    for (size_t i = keys.size();1 < i;--i) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        std::swap(keys[i-1], keys[x % i]);
+    }
+}
+
+static void get_cpus(std::vector<int>& cpus)
+{
+    cpus.clear();
+#if defined(__linux__)
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int i = 0;i < CPU_SETSIZE;++i) {
+            if (CPU_ISSET(i, &set)) {
+                cpus.push_back(i);
+            }
+        }
+    }
+#endif
+}
+
+static void pin_thread(int cpu)
+{
+#if defined(__linux__)
+    if (0 <= cpu) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        sched_setaffinity(0, sizeof(set), &set);
+    }
+#endif
+}
+
+static void output_counters(std::ostream& os, const perf_counters& pc, double n)
+{
+    for (int i = 0;i < perf_counters::NUM_EVENTS;++i) {
+        os << perf_counters::name(i) << ": ";
+        if (pc.available(i)) {
+            os << pc.value(i) << " (" << pc.value(i) / n << " per operation)";
+        } else {
+            os << "unavailable";
+        }
+        os << std::endl;
+    }
+}
+
+template <class trie_type>
+static int count_events(
+    std::ostream& os,
+    trie_type& trie,
+    const std::vector<const char*>& keys
+    )
+{
+    static const char *patterns[] = {"input order", "sorted cursor", "shuffled"};
+    perf_counters pc;
+    std::vector<const char*> shuffled(keys);
+    shuffle_keys(shuffled);
+
+    os << "Size of an element in bytes: " << sizeof(typename trie_type::element_type) << std::endl;
+    if (!pc.available()) {
+        os << "Hardware performance counters are unavailable; reporting times only" << std::endl;
+    }
+
+    for (int pattern = 0;pattern < 3;++pattern) {
+        const std::vector<const char*>& v = (pattern == 2) ? shuffled : keys;
+        typename trie_type::sorted_cursor sc = trie.sorted();
+        size_t misses = 0;
+
+        clock_t start = clock();
+        pc.start();
+        for (size_t i = 0;i < v.size();++i) {
+            bool found = (pattern == 1) ? sc.in(v[i]) : trie.in(v[i]);
+            if (!found) {
+                ++misses;
+            }
+        }
+        pc.stop();
+        clock_t end = clock();
+
+        os << "[" << patterns[pattern] << "]" << std::endl;
+        os << "Elapsed time: " << (end - start) / (double)CLOCKS_PER_SEC << std::endl;
+        os << "Number of keys not found: " << misses << std::endl;
+        output_counters(os, pc, (double)v.size());
+    }
+    return 0;
+}
+
+#if defined(DASTRIE_TEST_THREADS)
+
+template <class trie_type>
+struct reader
+{
+    const trie_type* shared;
+    const std::string* db;
+    const std::vector<const char*>* keys;
+    size_t begin;
+    int rounds;
+    int cpu;
+    std::atomic<int>* ready;
+    std::atomic<bool>* go;
+    size_t misses;
+
+    void operator()()
+    {
+        pin_thread(cpu);
+
+        // Read a copy of the trie in the memory local to the thread.
+        trie_type copy;
+        const trie_type* trie = shared;
+        if (trie == NULL) {
+            std::ifstream ifs(db->c_str(), std::ios::binary);
+            copy.read(ifs);
+            trie = &copy;
+        }
+
+        // Wait until all threads are ready.
+        ++*ready;
+        while (!go->load()) {
+            std::this_thread::yield();
+        }
+
+        // Start from a different position in the keys from other threads.
+        const std::vector<const char*>& v = *keys;
+        size_t n = v.size();
+        for (int r = 0;r < rounds;++r) {
+            for (size_t i = 0, j = begin;i < n;++i) {
+                if (!trie->in(v[j])) {
+                    ++misses;
+                }
+                if (++j == n) {
+                    j = 0;
+                }
+            }
+        }
+    }
+};
+
+template <class trie_type>
+static int scale(
+    std::ostream& os,
+    const trie_type& trie,
+    std::vector<const char*>& keys,
+    const option& opt
+    )
+{
+    bool copy = (opt.scale == "copy");
+    std::vector<int> cpus;
+    get_cpus(cpus);
+    int max_threads = cpus.empty() ?
+        (int)std::thread::hardware_concurrency() : (int)cpus.size();
+    if (max_threads <= 0) {
+        max_threads = 1;
+    }
+
+    shuffle_keys(keys);
+
+    os << "Scaling mode: " << opt.scale << std::endl;
+    os << "Number of cores: " << max_threads << std::endl;
+    for (int n = 1;;n = (n * 2 < max_threads ? n * 2 : max_threads)) {
+        std::atomic<int> ready(0);
+        std::atomic<bool> go(false);
+        std::vector<reader<trie_type> > readers(n);
+        std::vector<std::thread> threads;
+        for (int t = 0;t < n;++t) {
+            reader<trie_type>& r = readers[t];
+            r.shared = copy ? NULL : &trie;
+            r.db = &opt.db;
+            r.keys = &keys;
+            r.begin = keys.size() * t / n;
+            r.rounds = opt.rounds;
+            r.cpu = cpus.empty() ? -1 : cpus[t % cpus.size()];
+            r.ready = &ready;
+            r.go = &go;
+            r.misses = 0;
+        }
+        for (int t = 0;t < n;++t) {
+            threads.push_back(std::thread(std::ref(readers[t])));
+        }
+
+        // Measure the wall-clock time from the start to the last thread.
+        while (ready.load() < n) {
+            std::this_thread::yield();
+        }
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        go = true;
+        for (int t = 0;t < n;++t) {
+            threads[t].join();
+        }
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+        size_t misses = 0;
+        for (int t = 0;t < n;++t) {
+            misses += readers[t].misses;
+        }
+        double sec = std::chrono::duration<double>(end - start).count();
+        double lookups = (double)keys.size() * opt.rounds * n;
+        os << "Threads: " << n << ", wall-clock time: " << sec <<
+            ", throughput: " << (lookups / sec) << " lookups/s, " <<
+            (lookups / sec / n) << " lookups/s per thread" << std::endl;
+        if (misses != 0) {
+            std::cerr << "ERROR: " << misses << " look-ups failed" << std::endl;
+        }
+
+        if (n == max_threads) {
+            break;
+        }
+    }
+    return 0;
+}
+
+class stopwatch
+{
+public:
+    typedef std::chrono::steady_clock clock_type;
+
+    static uint64_t elapsed(clock_type::time_point from, clock_type::time_point to)
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count();
+    }
+
+    /**
+     * Measures the time of reading the clock twice; the minimum of many
+     * trials is subtracted from every latency.
+     */
+    static uint64_t overhead()
+    {
+        uint64_t min = (uint64_t)-1;
+        for (int i = 0;i < 10000;++i) {
+            clock_type::time_point t0 = clock_type::now();
+            clock_type::time_point t1 = clock_type::now();
+            uint64_t d = elapsed(t0, t1);
+            if (d < min) {
+                min = d;
+            }
+        }
+        return min;
+    }
+};
+
+template <class trie_type>
+static bool lookup(trie_type& trie, const char *key, const std::string& op)
+{
+    if (op[0] == 'i') {
+        return trie.in(key);
+    } else if (op[0] == 'f') {
+        typename trie_type::value_type value;
+        return trie.find(key, value);
+    } else {
+        bool found = false;
+        typename trie_type::prefix_cursor pfx = trie.prefix(key);
+        while (pfx.next()) {
+            found = true;
+        }
+        return found;
+    }
+}
+
+static void output_histogram(std::ostream& os, const char *name, const histogram& h)
+{
+    os << name << ": " << h.count();
+    if (0 < h.count()) {
+        os << ", p50: " << h.percentile(50.);
+        os << ", p90: " << h.percentile(90.);
+        os << ", p99: " << h.percentile(99.);
+        os << ", p99.9: " << h.percentile(99.9);
+        os << ", max: " << h.max();
+    }
+    os << std::endl;
+}
+
+template <class trie_type>
+static int latency(
+    std::ostream& os,
+    trie_type& trie,
+    const std::vector<const char*>& keys,
+    const option& opt
+    )
+{
+    typedef stopwatch::clock_type clock_type;
+    histogram hits, misses;
+    uint64_t overhead = stopwatch::overhead();
+    size_t n = keys.size() * opt.rounds;
+
+    // Schedule the look-ups at a fixed rate in the open-loop mode.
+    double interval = 0 < opt.rate ? 1e9 / opt.rate : 0.;
+    clock_type::time_point start = clock_type::now();
+
+    for (size_t i = 0;i < n;++i) {
+        const char *key = keys[i % keys.size()];
+        clock_type::time_point begin;
+        if (0 < interval) {
+            begin = start + std::chrono::nanoseconds((uint64_t)(interval * i));
+            while (clock_type::now() < begin) {
+                // Wait for the scheduled time.
+            }
+        } else {
+            begin = clock_type::now();
+        }
+        bool found = lookup(trie, key, opt.latency);
+        uint64_t t = stopwatch::elapsed(begin, clock_type::now());
+        t = overhead < t ? t - overhead : 0;
+        (found ? hits : misses).record(t);
+    }
+    double sec = stopwatch::elapsed(start, clock_type::now()) / 1e9;
+
+    os << "Operation: " << opt.latency << std::endl;
+    if (0 < interval) {
+        os << "Mode: open loop, " << opt.rate << " look-ups/s scheduled" << std::endl;
+    } else {
+        os << "Mode: closed loop" << std::endl;
+    }
+    os << "Timer overhead subtracted (ns): " << overhead << std::endl;
+    os << "Wall-clock time: " << sec << ", throughput: " << (n / sec) << " look-ups/s" << std::endl;
+    os << "Latency (ns):" << std::endl;
+    output_histogram(os, "  Hits", hits);
+    output_histogram(os, "  Misses", misses);
+    return 0;
+}
+
+#else
+
+template <class trie_type>
+static int latency(
+    std::ostream& os,
+    trie_type& trie,
+    const std::vector<const char*>& keys,
+    const option& opt
+    )
+{
+    std::cerr << "ERROR: The latency benchmark requires C++11." << std::endl;
+    return 1;
+}
+
+template <class trie_type>
+static int scale(
+    std::ostream& os,
+    const trie_type& trie,
+    std::vector<const char*>& keys,
+    const option& opt
+    )
+{
+    std::cerr << "ERROR: The scaling benchmark requires C++11." << std::endl;
+    return 1;
+}
+
+#endif/*DASTRIE_TEST_THREADS*/
+
 static char* read_text(const char *filename, std::streamoff& size)
 {
     // Open the input file.
@@ -107,7 +625,9 @@ template <class value_type, class traits_type>
 int test(char *text, size_t size, const option& opt)
 {
     typedef dastrie::trie<char*, traits_type> trie_type;
+    typedef dastrie::numa_trie<char*, traits_type> numa_trie_type;
     trie_type trie;
+    numa_trie_type numa;
     char *p = text, *key = NULL;
     std::ostream& os = std::cout;
     std::ostream& es = std::cerr;
@@ -123,12 +643,55 @@ int test(char *text, size_t size, const option& opt)
         return 1;
     }
 
-    if (trie.read(ifs) == 0) {
+    if (opt.numa) {
+        if (numa.read(ifs) == 0) {
+            es << "ERROR: Failed to read the database." << std::endl;
+            return 1;
+        }
+
+        // Report the memory used by the replica on each node.
+        os << "Number of NUMA nodes: " << numa.num_nodes() << std::endl;
+        os << "Number of replicas: " << numa.replicate() << std::endl;
+        for (int i = 0;i < numa.num_nodes();++i) {
+            os << "Replica size on node #" << i << ": " << numa.node_bytes(i) << std::endl;
+        }
+    } else if (trie.read(ifs) == 0) {
         es << "ERROR: Failed to read the database." << std::endl;
         return 1;
     }
 
+    if (!opt.warmup.empty() && !opt.numa) {
+        output_residency(os, trie, "before warm-up");
+        if (!warmup(os, trie, opt.warmup)) {
+            es << "ERROR: Failed to read the profile." << std::endl;
+            return 1;
+        }
+        output_residency(os, trie, "after warm-up");
+    }
+
+    if (!opt.scale.empty() && !opt.numa) {
+        std::vector<const char*> keys;
+        split_keys(p, keys);
+        os << "Number of keys: " << keys.size() << std::endl;
+        return scale(os, trie, keys, opt);
+    }
+
+    if (opt.counters && !opt.numa) {
+        std::vector<const char*> keys;
+        split_keys(p, keys);
+        os << "Number of keys: " << keys.size() << std::endl;
+        return count_events(os, trie, keys);
+    }
+
+    if (!opt.latency.empty() && !opt.numa) {
+        std::vector<const char*> keys;
+        split_keys(p, keys);
+        os << "Number of queries: " << keys.size() << std::endl;
+        return latency(os, trie, keys, opt);
+    }
+
     size_t n = 0;
+    typename trie_type::sorted_cursor sc = trie.sorted();
     clock_t start = clock();
 
     key = p;
@@ -138,7 +701,9 @@ int test(char *text, size_t size, const option& opt)
         if (*p == '\n' || *p == 0) {
             *p = 0;
             ++n;
-            if (!trie.in(key)) {
+            bool found = opt.numa ? numa.in(key) :
+                (opt.sorted ? sc.in(key) : trie.in(key));
+            if (!found) {
                 es << "ERROR: The key not found, " << key << std::endl;
             }
             key = p+1;
@@ -155,6 +720,15 @@ int test(char *text, size_t size, const option& opt)
     os << "Elapsed time: " <<
         (end - start) / (double)CLOCKS_PER_SEC << std::endl;
 
+    if (!opt.profile.empty() && !opt.numa) {
+        std::ofstream ofs(opt.profile.c_str(), std::ios::binary);
+        if (ofs.fail()) {
+            es << "ERROR: Failed to write the profile." << std::endl;
+            return 1;
+        }
+        os << "Pages in the profile: " << trie.save_profile(ofs) << std::endl;
+    }
+
     return 0;
 }
 
@@ -203,12 +777,33 @@ int main(int argc, char *argv[])
         return 1;
     }
 
+    // Identify the size of double-array elements from the database.
+    if (!opt.db.empty()) {
+        std::ifstream ifs(opt.db.c_str(), std::ios::binary);
+        int width = dastrie::probe(ifs);
+        if (width == 4) {
+            opt.compact = true;
+            opt.wide = false;
+        } else if (width == 5) {
+            opt.compact = false;
+            opt.wide = false;
+        } else if (width == 8) {
+            opt.compact = false;
+            opt.wide = true;
+        }
+    }
+
     // Dispatch.
     if (opt.compact) {
         return test<
             dastrie::empty_type,
             dastrie::doublearray4_traits
         >(text, (size_t)textsize, opt);
+    } else if (opt.wide) {
+        return test<
+            dastrie::empty_type,
+            dastrie::doublearray8_traits
+        >(text, (size_t)textsize, opt);
     } else {
         return test<
             dastrie::empty_type,
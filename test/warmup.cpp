@@ -0,0 +1,92 @@
+/*
+ *      A regression test for warming up the top levels of a trie.
+ *
+ * Copyright (c) 2008, Naoaki Okazaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Northwestern University, University of Tokyo,
+ *       nor the names of its contributors may be used to endorse or promote
+ *       products derived from this software without specific prior written
+ *       permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* $Id$ */
+
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <dastrie.h>
+
+typedef dastrie::builder<char*, dastrie::empty_type> builder_type;
+typedef dastrie::trie<dastrie::empty_type> trie_type;
+
+int main()
+{
+    // Generate keys whose lengths and alphabets vary (deterministically).
+    std::vector<std::string> keys;
+    unsigned int seed = 1;
+    for (int i = 0;i < 20000;++i) {
+        std::string key;
+        seed = seed * 1103515245 + 12345;
+        int length = 1 + (seed >> 16) % 12;
+        for (int j = 0;j < length;++j) {
+            seed = seed * 1103515245 + 12345;
+            key += (char)('a' + (seed >> 16) % 26);
+        }
+        keys.push_back(key);
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    std::vector<builder_type::record_type> records(keys.size());
+    for (size_t i = 0;i < keys.size();++i) {
+        records[i].key = const_cast<char*>(keys[i].c_str());
+    }
+
+    // Build a trie, and read it back.
+    builder_type builder;
+    builder.build(&records[0], &records[0] + records.size());
+    std::stringstream ss;
+    builder.write(ss);
+    trie_type trie;
+    if (trie.read(ss) == 0) {
+        std::cerr << "ERROR: Failed to read the trie." << std::endl;
+        return 1;
+    }
+
+    // The nodes visited never outnumber the elements in use.
+    size_t num_used = builder.stat().da_num_used;
+    size_t prev = 0;
+    for (int depth = 0;depth <= 64;++depth) {
+        size_t n = trie.warmup_levels(depth);
+        if (num_used < n || n < prev) {
+            std::cerr << "ERROR: warmup_levels(" << depth << ") visited " << n
+                << " nodes; " << num_used << " elements are in use." << std::endl;
+            return 1;
+        }
+        prev = n;
+    }
+    return 0;
+}